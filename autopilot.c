@@ -0,0 +1,444 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "autopilot.h"
+
+// Shortcuts may only make the part of the cycle from the tail to the head
+// cover less than 1 / SHORTCUT_MAX_SHARE of the board, so the tail passes the
+// skipped cells long before the snake gets close to filling the board
+#define SHORTCUT_MAX_SHARE 4
+
+static const Coord neighbour_offsets[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+static const UserInteraction neighbour_inputs[] = {DIRECTION_LEFT, DIRECTION_RIGHT, DIRECTION_UP, DIRECTION_DOWN};
+
+// Position of a cell on a cycle through `height` rows of `width` cells
+// The cycle runs right along the first row, then back and forth along the
+// other rows leaving out the first column, and up the first column back to
+// the start. This needs an even amount of rows.
+static long long rows_cycle_index(long long width, long long height, int x, int y)
+{
+	if (y == 0)
+		return x;
+	else if (x == 0)
+		return width + (height - 1) * (width - 1) + (height - 1 - y);
+	else
+		return width + (y - 1) * (width - 1) + ((y % 2 != 0) ? (width - 1 - x) : (x - 1));
+}
+
+// Position of a cell on the cycle
+// With open bounds and both sides odd, the cycle goes through all rows but
+// the last one like above. Between the first two cells it leaves the board
+// upwards into the last row and runs left along it, through the side and
+// back to the cell above the second one.
+static long long cycle_index(const Autopilot *autopilot, GameState *state, Coord cell)
+{
+	if (autopilot->cycle_built)
+		return autopilot->cycle[cell_index(state, cell)];
+
+	long long width = autopilot->width, height = autopilot->height;
+	int x = autopilot->transposed ? cell.y : cell.x;
+	int y = autopilot->transposed ? cell.x : cell.y;
+
+	if (height % 2 == 0)
+		return rows_cycle_index(width, height, x, y);
+	if (y == height - 1)
+		return (x == 0) ? 1 : 1 + width - x;
+	long long index = rows_cycle_index(width, height - 1, x, y);
+	return (index == 0) ? 0 : index + width;
+}
+
+// Gets the neighbour of `cell` in direction `i` of `neighbour_offsets`
+// Returns `false` if it is outside of the board, `true` otherwise
+static bool neighbour(const GameState *state, Coord cell, int i, Coord *result)
+{
+	cell.x += neighbour_offsets[i].x;
+	cell.y += neighbour_offsets[i].y;
+	if (state->rules.open_bounds_flag)
+	{
+		cell.x = (cell.x + state->board_size.x) % state->board_size.x;
+		cell.y = (cell.y + state->board_size.y) % state->board_size.y;
+	}
+	else if (cell.x < 0 || cell.y < 0 || cell.x >= state->board_size.x || cell.y >= state->board_size.y)
+	{
+		return false;
+	}
+
+	*result = cell;
+	return true;
+}
+
+// Builds a cycle through all cells of a board with walls except the walls
+// The cycle starts as a square of four cells and grows by detours: the edge
+// between two cells of the cycle is replaced by a path through the two cells
+// next to them on one side, if these are not on the cycle yet. Finding a
+// Hamiltonian cycle is hard in general, so this may get stuck before it
+// went through every cell.
+// Returns `true` if it went through every cell, `false` otherwise
+static bool build_cycle(Autopilot *autopilot, GameState *state)
+{
+	int width = state->board_size.x, height = state->board_size.y;
+	if (width < 2 || height < 2)
+		return false;
+
+	// Cells on the cycle carry the first mark of the search in `visited`,
+	// the successor of a cell on the cycle is kept in the queue of the search
+	unsigned int *next = autopilot->queue;
+	unsigned int *visited = autopilot->visited;
+	memset(visited, 0, (long long)width * height * sizeof(unsigned int));
+	autopilot->visit_mark = 1;
+
+	// Start with the first square of free cells, clockwise from its top left
+	// corner
+	long long cells = 0;
+	unsigned int start = 0;
+	bool found = false;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (get_cell(state, x, y) == WALL_CELL)
+				continue;
+			cells++;
+
+			Coord corners[4] = {coord(x, y)};
+			if (found || !neighbour(state, corners[0], 1, &corners[1]) ||
+				!neighbour(state, corners[1], 3, &corners[2]) || !neighbour(state, corners[0], 3, &corners[3]) ||
+				get_cell(state, corners[1].x, corners[1].y) == WALL_CELL ||
+				get_cell(state, corners[2].x, corners[2].y) == WALL_CELL ||
+				get_cell(state, corners[3].x, corners[3].y) == WALL_CELL)
+				continue;
+
+			for (int i = 0; i < 4; i++)
+			{
+				unsigned int index = cell_index(state, corners[i]);
+				next[index] = cell_index(state, corners[(i + 1) % 4]);
+				visited[index] = 1;
+			}
+			start = cell_index(state, corners[0]);
+			found = true;
+		}
+	}
+	if (!found)
+		return false;
+
+	// Walk the cycle and take every detour, until a walk around it takes none
+	long long length = 4;
+	bool grown = true;
+	while (grown && length < cells)
+	{
+		grown = false;
+		unsigned int a = start;
+		do
+		{
+			unsigned int b = next[a];
+			Coord from = cell_coord(state, a), to = cell_coord(state, b);
+
+			// Detours go up and down from an edge along a row, left and right
+			// from an edge along a column
+			int sides = (from.y == to.y) ? 2 : 0;
+			for (int side = sides; side < sides + 2; side++)
+			{
+				Coord c, d;
+				if (!neighbour(state, from, side, &c) || !neighbour(state, to, side, &d))
+					continue;
+				unsigned int c_index = cell_index(state, c), d_index = cell_index(state, d);
+				if (c_index == d_index || visited[c_index] || visited[d_index] ||
+					get_cell(state, c.x, c.y) == WALL_CELL || get_cell(state, d.x, d.y) == WALL_CELL)
+					continue;
+
+				next[a] = c_index;
+				next[c_index] = d_index;
+				next[d_index] = b;
+				visited[c_index] = visited[d_index] = 1;
+				length += 2;
+				grown = true;
+				break;
+			}
+			a = next[a];
+		} while (a != start);
+	}
+	if (length < cells)
+		return false;
+
+	// Number the cells along the cycle
+	unsigned int index = start;
+	for (long long position = 0; position < length; position++)
+	{
+		autopilot->cycle[index] = position;
+		index = next[index];
+	}
+	autopilot->cycle_length = length;
+	return true;
+}
+
+void init_autopilot(Autopilot *autopilot, GameState *state)
+{
+	int width = state->board_size.x, height = state->board_size.y;
+
+	// A grid only has a Hamiltonian cycle if one of its sides is even, with
+	// open bounds it always has one
+	autopilot->transposed = (height % 2 != 0);
+	autopilot->width = autopilot->transposed ? height : width;
+	autopilot->height = autopilot->transposed ? width : height;
+	autopilot->has_cycle = state->walls.count == 0 && width >= 2 && height >= 2 &&
+						   (autopilot->height % 2 == 0 || state->rules.open_bounds_flag);
+	autopilot->cycle_built = false;
+	autopilot->cycle_length = (long long)width * height;
+
+	// The food of the round is not placed yet
+	autopilot->food = coord(-1, -1);
+	autopilot->food_tick = 0;
+
+	// Paths to the food are searched on every board that is small enough to
+	// keep the dense structures, the space for the search is kept for the
+	// next rounds
+	long long area = (long long)width * height;
+	if (state->dense && autopilot->search_capacity < area)
+	{
+		free(autopilot->queue);
+		free(autopilot->visited);
+		free(autopilot->cycle);
+		autopilot->queue = malloc(area * sizeof(unsigned int));
+		autopilot->visited = calloc(area, sizeof(unsigned int));
+		autopilot->cycle = malloc(area * sizeof(unsigned int));
+		autopilot->visit_mark = 0;
+		bool allocated = autopilot->queue != NULL && autopilot->visited != NULL && autopilot->cycle != NULL;
+		autopilot->search_capacity = allocated ? area : 0;
+	}
+
+	// Around walls the cycle is built cell by cell
+	if (state->walls.count > 0 && autopilot->search_capacity >= area)
+	{
+		autopilot->cycle_built = build_cycle(autopilot, state);
+		autopilot->has_cycle = autopilot->cycle_built;
+	}
+}
+
+void free_autopilot(Autopilot *autopilot)
+{
+	free(autopilot->queue);
+	free(autopilot->visited);
+	free(autopilot->cycle);
+	memset(autopilot, 0, sizeof(Autopilot));
+}
+
+// Follows the cycle, taking the neighbour closest to the food on the cycle
+// that is allowed to be skipped to
+// Returns `false` if there is no such neighbour, `true` otherwise
+static bool cycle_move(Autopilot *autopilot, GameState *state, UserInteraction *input)
+{
+	long long cells = autopilot->cycle_length;
+	long long head = cycle_index(autopilot, state, state->pos);
+	long long tail = cycle_index(autopilot, state, cell_coord(state, state->body[state->body_tail]));
+	long long food = cycle_index(autopilot, state, state->food_coord);
+
+	// Cells from the tail to the head on the cycle. Skipped cells are still
+	// free, but until the tail passes them the snake can't use them, so this
+	// part has to leave room for the snake to grow.
+	long long covered = (head - tail + cells) % cells + 1;
+
+	long long best_distance = cells;
+	bool found = false;
+	for (int i = 0; i < 4; i++)
+	{
+		Coord next;
+		if (!neighbour(state, state->pos, i, &next) || is_on_obstacle(state, next.x, next.y))
+			continue;
+
+		long long index = cycle_index(autopilot, state, next);
+		long long skip = (index - head + cells) % cells;
+
+		// A skip must leave room for the growth still to come and for the
+		// growth of the food
+		if (skip != 1 && (covered + skip + state->growing + SUPERFOOD_GROW_FACTOR) * SHORTCUT_MAX_SHARE >= cells)
+			continue;
+
+		long long distance = (food - index + cells) % cells;
+		if (distance < best_distance)
+		{
+			best_distance = distance;
+			*input = neighbour_inputs[i];
+			found = true;
+		}
+	}
+	return found;
+}
+
+// Searches the shortest paths from the food to the neighbours of the head,
+// around walls and the snake, and sets their lengths in `distances` (in
+// the order of `neighbour_offsets`, -1 for neighbours without a path)
+static void food_distances(Autopilot *autopilot, GameState *state, long long distances[4])
+{
+	long long area = (long long)state->board_size.x * state->board_size.y;
+
+	// Cells visited in this search carry the current mark
+	if (++autopilot->visit_mark == 0)
+	{
+		memset(autopilot->visited, 0, area * sizeof(unsigned int));
+		autopilot->visit_mark = 1;
+	}
+
+	// The search stops once it reached every free neighbour
+	unsigned int targets[4];
+	int missing = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		Coord next;
+		distances[i] = -1;
+		targets[i] = area;
+		if (neighbour(state, state->pos, i, &next) && !is_on_obstacle(state, next.x, next.y))
+		{
+			targets[i] = cell_index(state, next);
+			missing++;
+		}
+	}
+
+	// Breadth-first search, `layer_end` is where the cells one step further
+	// from the food start in the queue
+	unsigned int *queue = autopilot->queue;
+	long long head = 0, tail = 0, layer_end = 1, distance = 0;
+	queue[tail++] = cell_index(state, state->food_coord);
+	autopilot->visited[queue[0]] = autopilot->visit_mark;
+	while (head < tail && missing > 0)
+	{
+		if (head == layer_end)
+		{
+			distance++;
+			layer_end = tail;
+		}
+		unsigned int index = queue[head++];
+		for (int i = 0; i < 4; i++)
+		{
+			if (targets[i] == index)
+			{
+				distances[i] = distance;
+				missing--;
+			}
+		}
+
+		Coord cell = cell_coord(state, index);
+		for (int i = 0; i < 4; i++)
+		{
+			Coord next;
+			if (!neighbour(state, cell, i, &next) || is_on_obstacle(state, next.x, next.y))
+				continue;
+
+			unsigned int next_index = cell_index(state, next);
+			if (autopilot->visited[next_index] != autopilot->visit_mark)
+			{
+				autopilot->visited[next_index] = autopilot->visit_mark;
+				queue[tail++] = next_index;
+			}
+		}
+	}
+}
+
+// Moves along a shortest path to the food, preferring neighbours from which
+// enough free cells can be reached for the snake to fit in
+// A snake that didn't get to the food for as many steps as the board has
+// cells is going round in circles, it heads for the food regardless then.
+static UserInteraction greedy_move(Autopilot *autopilot, GameState *state)
+{
+	Coord head = state->pos;
+	UserInteraction input = NO_INPUT;
+	long long best_reachable = -1;
+	long long best_distance = 0;
+	bool best_safe = false;
+
+	long long cells = (long long)state->board_size.x * state->board_size.y;
+	if (state->food_coord.x != autopilot->food.x || state->food_coord.y != autopilot->food.y)
+	{
+		autopilot->food = state->food_coord;
+		autopilot->food_tick = state->ticks;
+	}
+	bool stuck = state->ticks - autopilot->food_tick > cells;
+
+	// Without the dense structures the board is far larger than the snake
+	// and the distance to the food is estimated
+	long long distances[4];
+	bool searched = state->dense && autopilot->search_capacity >= cells;
+	if (searched)
+		food_distances(autopilot, state, distances);
+
+	Coord neighbours[4];
+	bool movable[4];
+	for (int i = 0; i < 4; i++)
+		movable[i] = neighbour(state, head, i, &neighbours[i]) &&
+				  !is_on_obstacle(state, neighbours[i].x, neighbours[i].y);
+
+	// Flood the board as if the head was already on a neighbour. The other
+	// neighbours the flood gets to reach the same cells, so the board is only
+	// flooded again for neighbours cut off from the ones before: one flood
+	// per step unless the head splits the free cells.
+	// Boards too large for flooding are far larger than the snake, so every
+	// move is taken as safe there.
+	long long reachable_from[4] = {-1, -1, -1, -1};
+	for (int i = 0; i < 4 && state->dense; i++)
+	{
+		if (!movable[i] || reachable_from[i] >= 0)
+			continue;
+
+		state->pos = neighbours[i];
+		reachable_from[i] = find_reachable(state) + 1;
+		state->pos = head;
+		for (int j = i + 1; j < 4; j++)
+		{
+			if (!movable[j])
+				continue;
+
+			Coord cell = neighbours[j];
+			uint64_t word = state->reach_bits[cell.y * state->board_words + cell.x / 64];
+			if ((word >> (cell.x % 64)) & 1)
+				reachable_from[j] = reachable_from[i];
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (!movable[i])
+			continue;
+
+		Coord next = neighbours[i];
+		long long reachable = state->dense ? reachable_from[i] : 0;
+		bool safe = stuck || !state->dense || reachable >= state->length + state->growing;
+
+		// Neighbours without a path to the food come last
+		long long distance;
+		if (searched)
+		{
+			distance = (distances[i] >= 0) ? distances[i] : cells;
+		}
+		else
+		{
+			int dx = abs(next.x - state->food_coord.x), dy = abs(next.y - state->food_coord.y);
+			if (state->rules.open_bounds_flag)
+			{
+				dx = (dx * 2 > state->board_size.x) ? state->board_size.x - dx : dx;
+				dy = (dy * 2 > state->board_size.y) ? state->board_size.y - dy : dy;
+			}
+			distance = dx + dy;
+		}
+
+		if (input == NO_INPUT ||
+			(safe && !best_safe) ||
+			(safe && distance < best_distance) ||
+			(safe && distance == best_distance && reachable > best_reachable) ||
+			(!safe && !best_safe && reachable > best_reachable))
+		{
+			input = neighbour_inputs[i];
+			best_reachable = reachable;
+			best_distance = distance;
+			best_safe = safe;
+		}
+	}
+	return input;
+}
+
+UserInteraction autopilot_move(Autopilot *autopilot, GameState *state)
+{
+	UserInteraction input;
+	if (autopilot->has_cycle && cycle_move(autopilot, state, &input))
+		return input;
+
+	return greedy_move(autopilot, state);
+}
@@ -0,0 +1,70 @@
+// Computer player that can fill the whole board
+// On boards without walls that have an even side or open bounds, the
+// autopilot follows a Hamiltonian cycle: a closed path visiting every cell
+// once. As long as the snake lies on the cycle in order, following it can
+// never hit the snake.
+// While the snake is short, it takes shortcuts towards the food that skip
+// parts of the cycle without overtaking its tail.
+//
+// The position of a cell on the cycle is computed from its coordinates, so
+// no table is needed and every move takes constant time.
+//
+// Around walls, a cycle is grown from a square by detours and its order is
+// kept in a table. This finds no cycle on many boards (there may be none:
+// every cycle alternates between the two colours of a checkerboard, which
+// walls can leave in unequal amounts).
+//
+// Boards without a cycle (both sides odd with closed bounds, walls the
+// growth got stuck at) are played greedily: the autopilot moves along a
+// shortest path to the food, avoiding moves after which the snake can't
+// reach enough free cells to fit in. Each step takes time in the size of the
+// board for the path and the flood. It can't promise to fill such a board, but it never circles
+// forever either: once it didn't get to the food for as many steps as the
+// board has cells, it heads for the food even if that's unsafe.
+
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <stdbool.h>
+
+#include "engine.h"
+
+typedef struct Autopilot
+{
+	// Whether the board has a Hamiltonian cycle the autopilot follows
+	bool has_cycle;
+	// The cycle is built along rows of even count (plus one through the open
+	// bounds if both sides are odd), with `transposed` set rows and columns of
+	// the board are swapped for this
+	bool transposed;
+	// Size of the board in the orientation of the cycle
+	int width;
+	int height;
+	// Whether the cycle goes around walls, it is built cell by cell then and
+	// `cycle` holds the position of every cell on it
+	bool cycle_built;
+	unsigned int *cycle;
+	// Amount of cells on the cycle
+	long long cycle_length;
+	// Position of the food and the tick it was first seen there
+	Coord food;
+	long long food_tick;
+	// Space for searching paths to the food on boards of up to
+	// `search_capacity` cells, cells visited by the current search carry
+	// `visit_mark` in `visited`
+	unsigned int *queue;
+	unsigned int *visited;
+	unsigned int visit_mark;
+	long long search_capacity;
+} Autopilot;
+
+// Prepares the autopilot for the round in `state`
+// `autopilot` has to be zero-initialized before the first round.
+void init_autopilot(Autopilot *autopilot, GameState *state);
+
+void free_autopilot(Autopilot *autopilot);
+
+// Chooses the input for the next step of the round
+UserInteraction autopilot_move(Autopilot *autopilot, GameState *state);
+
+#endif
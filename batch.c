@@ -0,0 +1,343 @@
+// we are using clocks and threads from POSIX
+// see here: https://www.gnu.org/software/libc/manual/html_node/Feature-Test-Macros.html#index-_005fPOSIX_005fC_005fSOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "autopilot.h"
+#include "batch.h"
+#include "bot.h"
+
+// One in this many steps of a random round changes the direction
+#define RANDOM_INPUT_CHANCE 8
+
+typedef struct Worker
+{
+	// Protects `next` and `end`
+	pthread_mutex_t lock;
+	// Rounds still to be played by this worker: [next, end)
+	long long next;
+	long long end;
+	// Amount of ranges this worker stole from others
+	long long steals;
+	pthread_t thread;
+	struct Pool *pool;
+} Worker;
+
+typedef struct Pool
+{
+	const BatchConfig *config;
+	RoundResult *results;
+	Worker *workers;
+	int worker_count;
+} Pool;
+
+static inline long long batch_now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * NANOSECS_IN_SEC + now.tv_nsec;
+}
+
+// Seed of a round, only depending on the seed of the batch and the round
+uint64_t round_seed(uint64_t batch_seed, long long round)
+{
+	Rng rng;
+	seed_rng(&rng, batch_seed + round);
+	return next_seed(&rng);
+}
+
+// Plays one round in `state`, reusing its buffers from the previous round
+// With `config->bot` set, the round is played by `bot`, with
+// `config->autopilot` set by `autopilot`
+void play_batch_round(const BatchConfig *config, GameState *state, Bot *bot, Autopilot *autopilot, long long round, RoundResult *result)
+{
+	uint64_t seed = round_seed(config->seed, round);
+	reset_state(state, config->board_size, &config->rules, seed);
+
+	// Random inputs are drawn from a generator of their own, so they don't
+	// change where the food appears
+	Rng inputs;
+	seed_rng(&inputs, ~seed);
+	size_t script_pos = 0;
+
+	if (config->autopilot)
+		init_autopilot(autopilot, state);
+	if (config->bot)
+		clear_bot(bot);
+
+	// Init food coordinates, a board without any free cell is already won
+	UpdateResult res = CONTINUE;
+	if (!new_food_coordinates(state, &state->food_coord))
+	{
+		res = BOARD_FULL;
+	}
+
+	while (res != GAME_OVER && res != BOARD_FULL && state->ticks < config->max_ticks)
+	{
+		if (config->autopilot)
+		{
+			push_input(autopilot_move(autopilot, state), state);
+		}
+		else if (config->bot)
+		{
+			// Without a time limit the moves don't depend on the load of the machine
+			push_input(bot_move(bot, state, 0), state);
+		}
+		else if (config->script != NULL)
+		{
+			push_input(config->script[script_pos], state);
+			script_pos = (script_pos + 1) % config->script_length;
+		}
+		else if (state->ticks == 0 || random_below(&inputs, RANDOM_INPUT_CHANCE) == 0)
+		{
+			push_input(DIRECTION_LEFT + random_below(&inputs, 4), state);
+		}
+
+		res = step_state(state, pop_current_input(state));
+	}
+
+	result->result = (res == GAME_OVER || res == BOARD_FULL) ? res : CONTINUE;
+	result->points = state->points;
+	result->length = state->length;
+	result->ticks = state->ticks;
+}
+
+// Takes the next round from the own range of the worker
+// Returns `false` if the range is empty, `true` otherwise
+bool take_round(Worker *worker, long long *round)
+{
+	pthread_mutex_lock(&worker->lock);
+	bool found = worker->next < worker->end;
+	if (found)
+	{
+		*round = worker->next++;
+	}
+	pthread_mutex_unlock(&worker->lock);
+	return found;
+}
+
+// Moves the back half of the largest range of the other workers to `thief`
+// Returns `false` if there are no rounds left to steal, `true` otherwise
+bool steal_rounds(Worker *thief)
+{
+	Pool *pool = thief->pool;
+	while (true)
+	{
+		// Find the worker with the most rounds left
+		Worker *victim = NULL;
+		long long most = 0;
+		for (int i = 0; i < pool->worker_count; i++)
+		{
+			Worker *worker = &pool->workers[i];
+			if (worker == thief)
+				continue;
+
+			pthread_mutex_lock(&worker->lock);
+			long long left = worker->end - worker->next;
+			pthread_mutex_unlock(&worker->lock);
+			if (left > most)
+			{
+				most = left;
+				victim = worker;
+			}
+		}
+		if (victim == NULL)
+		{
+			return false;
+		}
+
+		// The victim may have played some rounds in the meantime
+		long long start, end;
+		pthread_mutex_lock(&victim->lock);
+		end = victim->end;
+		start = end - (end - victim->next + 1) / 2;
+		victim->end = start;
+		pthread_mutex_unlock(&victim->lock);
+
+		if (start < end)
+		{
+			pthread_mutex_lock(&thief->lock);
+			thief->next = start;
+			thief->end = end;
+			thief->steals++;
+			pthread_mutex_unlock(&thief->lock);
+			return true;
+		}
+	}
+}
+
+// Takes the next round of the worker, stealing rounds once its own range is
+// empty. Stolen rounds can be stolen away again before the worker takes one,
+// so it keeps stealing until it got a round or all ranges are empty.
+// Returns `false` if there are no rounds left, `true` otherwise
+bool next_round(Worker *worker, long long *round)
+{
+	while (!take_round(worker, round))
+	{
+		if (!steal_rounds(worker))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void *run_worker(void *arg)
+{
+	Worker *worker = arg;
+	const BatchConfig *config = worker->pool->config;
+
+	// Rounds are already spread over the threads, so every worker has a bot
+	// searching on its own thread. A worker whose bot can't be started leaves
+	// its rounds to the others.
+	Bot bot;
+	if (config->bot && !init_bot(&bot, 1))
+		return NULL;
+
+	// Every worker plays all its rounds in the same state, with the same
+	// autopilot
+	GameState state;
+	memset(&state, 0, sizeof(GameState));
+	Autopilot autopilot;
+	memset(&autopilot, 0, sizeof(Autopilot));
+
+	long long round;
+	while (next_round(worker, &round))
+	{
+		play_batch_round(config, &state, &bot, &autopilot, round, &worker->pool->results[round]);
+	}
+
+	free_state(&state);
+	free_autopilot(&autopilot);
+	if (config->bot)
+		free_bot(&bot);
+	return NULL;
+}
+
+bool run_batch(const BatchConfig *config, BatchResult *result)
+{
+	result->rounds = malloc(config->rounds * sizeof(RoundResult));
+	result->steals = 0;
+	result->duration = 0;
+
+	Pool pool;
+	pool.config = config;
+	pool.results = result->rounds;
+	pool.worker_count = config->threads;
+	pool.workers = malloc(pool.worker_count * sizeof(Worker));
+	if (result->rounds == NULL || pool.workers == NULL)
+	{
+		free(pool.workers);
+		free_batch_result(result);
+		return false;
+	}
+
+	// Split the rounds evenly, stealing evens out what's left at the end
+	for (int i = 0; i < pool.worker_count; i++)
+	{
+		Worker *worker = &pool.workers[i];
+		pthread_mutex_init(&worker->lock, NULL);
+		worker->next = config->rounds * i / pool.worker_count;
+		worker->end = config->rounds * (i + 1) / pool.worker_count;
+		worker->steals = 0;
+		worker->pool = &pool;
+	}
+
+	long long start = batch_now_ns();
+
+	// The calling thread is the first worker. If a thread can't be started,
+	// the rounds of its worker are stolen by the others.
+	int started = 1;
+	while (started < pool.worker_count &&
+		   pthread_create(&pool.workers[started].thread, NULL, run_worker, &pool.workers[started]) == 0)
+	{
+		started++;
+	}
+	run_worker(&pool.workers[0]);
+
+	for (int i = 1; i < started; i++)
+	{
+		pthread_join(pool.workers[i].thread, NULL);
+	}
+
+	result->duration = batch_now_ns() - start;
+	bool played = true;
+	for (int i = 0; i < pool.worker_count; i++)
+	{
+		// Rounds are only left if no worker could play them
+		played = played && pool.workers[i].next == pool.workers[i].end;
+		result->steals += pool.workers[i].steals;
+		pthread_mutex_destroy(&pool.workers[i].lock);
+	}
+	free(pool.workers);
+	if (!played)
+		free_batch_result(result);
+	return played;
+}
+
+int compare_long_longs(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+	return (x > y) - (x < y);
+}
+
+// Prints min, mean, percentiles and max of `values`, sorting them
+void print_distribution(FILE *file, const char *name, long long *values, long long count)
+{
+	double sum = 0;
+	for (long long i = 0; i < count; i++)
+		sum += values[i];
+	qsort(values, count, sizeof(long long), compare_long_longs);
+
+	fprintf(file, "%-8s %12lld %12.1f %12lld %12lld %12lld %12lld\n", name, values[0], sum / count,
+			values[count / 2], values[count * 9 / 10], values[count * 99 / 100], values[count - 1]);
+}
+
+void print_batch_result(const BatchConfig *config, BatchResult *result, FILE *file)
+{
+	long long count = config->rounds;
+	long long game_over = 0, board_full = 0, tick_limit = 0;
+	for (long long i = 0; i < count; i++)
+	{
+		if (result->rounds[i].result == GAME_OVER)
+			game_over++;
+		else if (result->rounds[i].result == BOARD_FULL)
+			board_full++;
+		else
+			tick_limit++;
+	}
+
+	double seconds = (double)result->duration / NANOSECS_IN_SEC;
+	fprintf(file, "rounds: %lld on %d threads in %.2fs (%.0f rounds/s, %lld steals)\n",
+			count, config->threads, seconds, seconds > 0 ? count / seconds : 0, result->steals);
+	fprintf(file, "game over: %lld\nboard full: %lld\ntick limit: %lld\n", game_over, board_full, tick_limit);
+	if (count == 0)
+		return;
+
+	fprintf(file, "%-8s %12s %12s %12s %12s %12s %12s\n", "", "min", "mean", "p50", "p90", "p99", "max");
+	long long *values = malloc(count * sizeof(long long));
+	if (values == NULL)
+		return;
+
+	for (long long i = 0; i < count; i++)
+		values[i] = result->rounds[i].points;
+	print_distribution(file, "score", values, count);
+	for (long long i = 0; i < count; i++)
+		values[i] = result->rounds[i].length;
+	print_distribution(file, "length", values, count);
+	for (long long i = 0; i < count; i++)
+		values[i] = result->rounds[i].ticks;
+	print_distribution(file, "ticks", values, count);
+
+	free(values);
+}
+
+void free_batch_result(BatchResult *result)
+{
+	free(result->rounds);
+	result->rounds = NULL;
+}
@@ -0,0 +1,72 @@
+// Simulation of many headless rounds on a pool of threads
+// Rounds are independent of each other: every round has its own state and
+// random number generator, seeded from the seed of the batch and the number
+// of the round, so the results don't depend on how rounds are scheduled.
+//
+// Every thread owns a range of round numbers and takes rounds from its front.
+// A thread that runs out of rounds steals the back half of the largest range
+// left, so all threads stay busy until the whole batch is done.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "engine.h"
+
+typedef struct BatchConfig
+{
+	// Size of the board every round is played on
+	Coord board_size;
+	// Rules every round is played with
+	GameRules rules;
+	// Inputs fed to the rounds, one per step and repeated until the round ends
+	// If `NULL`, every round plays random inputs drawn from its own generator.
+	const UserInteraction *script;
+	size_t script_length;
+	// Whether the autopilot plays the rounds instead
+	bool autopilot;
+	// Whether the lookahead bot plays the rounds instead
+	bool bot;
+	// Maximum amount of steps a round may take
+	long long max_ticks;
+	// Seed the seeds of the rounds are derived from
+	uint64_t seed;
+	// Amount of rounds to play
+	long long rounds;
+	// Amount of threads to play them on
+	int threads;
+} BatchConfig;
+
+typedef struct RoundResult
+{
+	// How the round ended (`CONTINUE` if it hit the tick limit)
+	UpdateResult result;
+	long long points;
+	int length;
+	long long ticks;
+} RoundResult;
+
+typedef struct BatchResult
+{
+	// Result of every round, indexed by the number of the round
+	RoundResult *rounds;
+	// Amount of ranges of rounds that were stolen between threads
+	long long steals;
+	// Wall clock time (in ns) the batch took
+	long long duration;
+} BatchResult;
+
+// Plays all rounds of the batch
+// Returns `false` on error, `true` otherwise
+bool run_batch(const BatchConfig *config, BatchResult *result);
+
+// Prints how the rounds ended and the distributions of score, length and ticks
+void print_batch_result(const BatchConfig *config, BatchResult *result, FILE *file);
+
+void free_batch_result(BatchResult *result);
+
+#endif
@@ -0,0 +1,348 @@
+// Microbenchmarks for the hot paths of the game engine
+// Every benchmark takes a number of samples, each timing a batch of
+// operations, and reports the time per operation as percentiles over
+// all samples. The results are printed as a table and written as JSON
+// to the file given as first argument (default: bench.json).
+
+// we are using clocks from POSIX
+// see here: https://www.gnu.org/software/libc/manual/html_node/Feature-Test-Macros.html#index-_005fPOSIX_005fC_005fSOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "engine.h"
+
+#define SAMPLES 200
+#define DEFAULT_OUTPUT "bench.json"
+
+typedef struct BenchResult
+{
+	// Name of the benchmark
+	char name[64];
+	// Nanoseconds per operation, one entry per sample (sorted after `finish_bench`)
+	double samples[SAMPLES];
+} BenchResult;
+
+// Output file for the JSON results
+static FILE *json;
+// Whether a result was already written to the JSON array
+static bool json_started = false;
+
+static inline long long now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * NANOSECS_IN_SEC + now.tv_nsec;
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+double percentile(BenchResult *result, double p)
+{
+	int index = (int)(p * (SAMPLES - 1) + 0.5);
+	return result->samples[index];
+}
+
+// Sorts the samples of a benchmark and reports them
+void finish_bench(BenchResult *result)
+{
+	double sum = 0;
+	for (int i = 0; i < SAMPLES; i++)
+		sum += result->samples[i];
+	qsort(result->samples, SAMPLES, sizeof(double), compare_doubles);
+
+	printf("%-44s %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+		   result->name, result->samples[0], sum / SAMPLES,
+		   percentile(result, 0.5), percentile(result, 0.9), percentile(result, 0.99));
+
+	fprintf(json, "%s\n    {\"name\": \"%s\", \"samples\": %d, \"min_ns\": %.2f, \"mean_ns\": %.2f, "
+				  "\"p50_ns\": %.2f, \"p90_ns\": %.2f, \"p99_ns\": %.2f, \"max_ns\": %.2f}",
+			json_started ? "," : "", result->name, SAMPLES, result->samples[0], sum / SAMPLES,
+			percentile(result, 0.5), percentile(result, 0.9), percentile(result, 0.99),
+			result->samples[SAMPLES - 1]);
+	json_started = true;
+}
+
+GameRules default_rules(void)
+{
+	GameRules rules;
+	rules.open_bounds_flag = false;
+	rules.wall_flag = false;
+	rules.wall_pattern = 1;
+	return rules;
+}
+
+// Times `step_state` with a snake of `length` cells moving along a row of an
+// open-bounds board that is just wide enough, so it can move forever
+void bench_step(int length)
+{
+	const int batch = 1000;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "step_state/length=%d", length);
+
+	GameRules rules = default_rules();
+	rules.open_bounds_flag = true;
+	GameState state = init_state(coord(length + 16, 4), &rules, 1);
+
+	// Keep the food out of the way of the snake so its length stays constant
+	state.food_coord = coord(0, 0);
+	state.growing = length - 1;
+	while (state.length < length)
+		step_state(&state, DIRECTION_RIGHT);
+
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		long long start = now_ns();
+		for (int j = 0; j < batch; j++)
+			step_state(&state, NO_INPUT);
+		result.samples[i] = (double)(now_ns() - start) / batch;
+	}
+
+	free_state(&state);
+	finish_bench(&result);
+}
+
+// Creates a board with `fill` of all cells occupied by walls
+// The seed is fixed so every run benchmarks the same boards
+GameState filled_state(Coord size, double fill)
+{
+	GameRules rules = default_rules();
+	GameState state = init_state(size, &rules, 1);
+
+	int cells = (int)(fill * state.board_size.x * state.board_size.y);
+	while (state.board_size.x * state.board_size.y - state.free_count < cells)
+	{
+		Coord cell;
+		new_random_coordinates(&state, &cell);
+		set_cell(&state, cell, WALL_CELL);
+	}
+	return state;
+}
+
+void bench_obstacle(double fill)
+{
+	const int batch = 4096;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "is_on_obstacle/fill=%.2f", fill);
+
+	GameState state = filled_state(coord(256, 256), fill);
+	Coord *queries = malloc(batch * sizeof(Coord));
+	for (int i = 0; i < batch; i++)
+		queries[i] = coord(random_below(&state.rng, state.board_size.x), random_below(&state.rng, state.board_size.y));
+
+	// Count hits so the lookups can't be optimized away
+	volatile int hits = 0;
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		int sample_hits = 0;
+		long long start = now_ns();
+		for (int j = 0; j < batch; j++)
+			sample_hits += is_on_obstacle(&state, queries[j].x, queries[j].y);
+		result.samples[i] = (double)(now_ns() - start) / batch;
+		hits += sample_hits;
+	}
+
+	free(queries);
+	free_state(&state);
+	finish_bench(&result);
+}
+
+void bench_random_coordinates(double fill)
+{
+	const int batch = 1024;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "new_random_coordinates/fill=%.2f", fill);
+
+	GameState state = filled_state(coord(256, 256), fill);
+	Coord cell;
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		long long start = now_ns();
+		for (int j = 0; j < batch; j++)
+			new_random_coordinates(&state, &cell);
+		result.samples[i] = (double)(now_ns() - start) / batch;
+	}
+
+	free_state(&state);
+	finish_bench(&result);
+}
+
+// Times spawning food on a reachable cell of a 500x200 board, which floods
+// the board from the head every time
+void bench_food(double fill)
+{
+	const int batch = 16;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "new_food_coordinates/500x200/fill=%.2f", fill);
+
+	GameState state = filled_state(coord(500, 200), fill);
+	Coord cell;
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		long long start = now_ns();
+		for (int j = 0; j < batch; j++)
+			new_food_coordinates(&state, &cell);
+		result.samples[i] = (double)(now_ns() - start) / batch;
+	}
+
+	free_state(&state);
+	finish_bench(&result);
+}
+
+// Same on a 500x200 board of vertical corridors that form one long path,
+// the worst case for the row-wise flood
+void bench_food_corridors(void)
+{
+	const int batch = 4;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "new_food_coordinates/500x200/corridors");
+
+	GameState state = filled_state(coord(500, 200), 0);
+	for (int x = 1; x < state.board_size.x; x += 2)
+	{
+		// Leave a gap at the bottom and the top in turns
+		int gap = (x / 2 % 2 == 0) ? state.board_size.y - 1 : 0;
+		for (int y = 0; y < state.board_size.y; y++)
+			if (y != gap)
+				set_cell(&state, coord(x, y), WALL_CELL);
+	}
+
+	Coord cell;
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		long long start = now_ns();
+		for (int j = 0; j < batch; j++)
+			new_food_coordinates(&state, &cell);
+		result.samples[i] = (double)(now_ns() - start) / batch;
+	}
+
+	free_state(&state);
+	finish_bench(&result);
+}
+
+// Times one push and one pop of an input, as done for every key press and step
+void bench_input_queue(void)
+{
+	const int batch = 4096;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "push_input+pop_current_input");
+
+	GameRules rules = default_rules();
+	GameState state = init_state(coord(16, 16), &rules, 1);
+	const UserInteraction inputs[] = {DIRECTION_UP, DIRECTION_LEFT, DIRECTION_DOWN, DIRECTION_RIGHT};
+
+	volatile int popped = 0;
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		long long start = now_ns();
+		for (int j = 0; j < batch; j += 2)
+		{
+			push_input(inputs[j % 4], &state);
+			push_input(inputs[(j + 1) % 4], &state);
+			popped += pop_current_input(&state);
+			popped += pop_current_input(&state);
+		}
+		result.samples[i] = (double)(now_ns() - start) / batch;
+	}
+
+	free_state(&state);
+	finish_bench(&result);
+}
+
+void bench_init_wall(short pattern, Coord size)
+{
+	const int batch = 16;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "init_wall/pattern=%d/%dx%d", pattern, size.x, size.y);
+
+	GameRules rules = default_rules();
+	rules.wall_flag = true;
+	rules.wall_pattern = pattern;
+
+	WallLayout layouts[16];
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		// Invalidate the layouts so the segments are derived again
+		for (int j = 0; j < batch; j++)
+			layouts[j].valid = false;
+
+		long long start = now_ns();
+		for (int j = 0; j < batch; j++)
+			init_wall(&layouts[j], size, &rules);
+		result.samples[i] = (double)(now_ns() - start) / batch;
+	}
+
+	finish_bench(&result);
+}
+
+// Times starting a new round in an existing state, as done on every restart
+void bench_reset_state(short pattern, Coord size)
+{
+	const int batch = 16;
+	BenchResult result;
+	snprintf(result.name, sizeof(result.name), "reset_state/pattern=%d/%dx%d", pattern, size.x, size.y);
+
+	GameRules rules = default_rules();
+	rules.wall_flag = true;
+	rules.wall_pattern = pattern;
+
+	GameState state = init_state(size, &rules, 1);
+	for (int i = 0; i < SAMPLES; i++)
+	{
+		long long start = now_ns();
+		for (int j = 0; j < batch; j++)
+			reset_state(&state, size, &rules, j);
+		result.samples[i] = (double)(now_ns() - start) / batch;
+	}
+
+	free_state(&state);
+	finish_bench(&result);
+}
+
+int main(int argc, char **argv)
+{
+	const char *output = argc > 1 ? argv[1] : DEFAULT_OUTPUT;
+	json = fopen(output, "w");
+	if (json == NULL)
+	{
+		fprintf(stderr, "Unable to write results to %s\n", output);
+		return 1;
+	}
+	fprintf(json, "{\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [");
+
+	printf("%-44s %10s %10s %10s %10s %10s\n", "benchmark (ns/op)", "min", "mean", "p50", "p90", "p99");
+
+	const int lengths[] = {10, 100, 1000, 10000, 100000};
+	for (int i = 0; i < 5; i++)
+		bench_step(lengths[i]);
+
+	const double fills[] = {0.0, 0.25, 0.5, 0.75, 0.9, 0.99};
+	for (int i = 0; i < 6; i++)
+		bench_obstacle(fills[i]);
+	for (int i = 0; i < 6; i++)
+		bench_random_coordinates(fills[i]);
+	for (int i = 0; i < 6; i++)
+		bench_food(fills[i]);
+	bench_food_corridors();
+
+	bench_input_queue();
+
+	const Coord sizes[] = {{80, 20}, {200, 60}, {1000, 300}};
+	for (short pattern = 1; pattern <= 5; pattern++)
+		for (int i = 0; i < 3; i++)
+			bench_init_wall(pattern, sizes[i]);
+	for (int i = 0; i < 3; i++)
+		bench_reset_state(5, sizes[i]);
+
+	fprintf(json, "\n  ]\n}\n");
+	fclose(json);
+	printf("Results written to %s\n", output);
+	return 0;
+}
@@ -0,0 +1,467 @@
+// we are using clocks and threads from POSIX
+// see here: https://www.gnu.org/software/libc/manual/html_node/Feature-Test-Macros.html#index-_005fPOSIX_005fC_005fSOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bot.h"
+
+// Entries of the transposition table (a power of two)
+#define BOT_TABLE_SIZE (1 << 18)
+// Key kind mixing the growth of the snake into the keys of the table
+#define BOT_GROWING_KEY 0x452821e638d01377ULL
+// Positions searched between two checks of the deadline
+#define BOT_DEADLINE_CHECK 1024
+
+// Scores of positions
+#define BOT_DEATH_SCORE -1000000
+#define BOT_TRAPPED_SCORE -500000
+#define BOT_FOOD_SCORE 100000
+// Superfood is worth five times the points like in `step_state`
+#define BOT_SUPERFOOD_FACTOR 5
+#define BOT_DEPTH_BONUS 1000
+#define BOT_SPACE_WEIGHT 16
+// Reachable cells beyond those the snake needs that still count for the score
+#define BOT_SPACE_MARGIN 32
+
+// Packing of the data of a table entry
+#define ENTRY_VALID (1ULL << 48)
+#define ENTRY_DEPTH_SHIFT 32
+#define ENTRY_MOVE_SHIFT 40
+#define NO_MOVE 7
+
+static const Coord move_offsets[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+static const UserInteraction move_inputs[] = {DIRECTION_LEFT, DIRECTION_RIGHT, DIRECTION_UP, DIRECTION_DOWN};
+
+// What has to be restored to take back a move
+typedef struct BotUndo
+{
+	Coord pos;
+	int growing;
+	int length;
+	bool popped;
+} BotUndo;
+
+static inline long long bot_now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * NANOSECS_IN_SEC + now.tv_nsec;
+}
+
+// Gets the cell a move from `pos` leads to
+// Returns `false` if it is outside of the board, `true` otherwise
+static inline bool move_target(const GameState *state, Coord pos, int move, Coord *target)
+{
+	pos.x += move_offsets[move].x;
+	pos.y += move_offsets[move].y;
+	if (state->rules.open_bounds_flag)
+	{
+		pos.x = (pos.x + state->board_size.x) % state->board_size.x;
+		pos.y = (pos.y + state->board_size.y) % state->board_size.y;
+	}
+	else if (pos.x < 0 || pos.y < 0 || pos.x >= state->board_size.x || pos.y >= state->board_size.y)
+	{
+		return false;
+	}
+
+	*target = pos;
+	return true;
+}
+
+// Moves the head of the snake of the searcher to `target` like `step_state` does
+void make_move(BotSearcher *s, Coord target, bool eats, BotUndo *undo)
+{
+	GameState *state = s->bot->state;
+	undo->pos = s->pos;
+	undo->growing = s->growing;
+	undo->length = s->length;
+
+	unsigned int index = cell_index(state, target);
+	s->cells[++s->cells_head] = index;
+	s->board[index] = SNAKE_CELL;
+	s->hash ^= zobrist_key(index, ZOBRIST_BODY);
+	s->pos = target;
+
+	if (eats)
+		s->growing += state->superfood_counter == 0 ? SUPERFOOD_GROW_FACTOR : GROW_FACTOR;
+
+	undo->popped = s->growing == 0;
+	if (undo->popped)
+	{
+		unsigned int tail = s->cells[s->cells_tail++];
+		s->board[tail] = EMPTY_CELL;
+		s->hash ^= zobrist_key(tail, ZOBRIST_BODY);
+	}
+	else
+	{
+		s->growing--;
+		s->length++;
+	}
+}
+
+void undo_move(BotSearcher *s, const BotUndo *undo)
+{
+	if (undo->popped)
+	{
+		unsigned int tail = s->cells[--s->cells_tail];
+		s->board[tail] = SNAKE_CELL;
+		s->hash ^= zobrist_key(tail, ZOBRIST_BODY);
+	}
+
+	unsigned int index = s->cells[s->cells_head--];
+	s->board[index] = EMPTY_CELL;
+	s->hash ^= zobrist_key(index, ZOBRIST_BODY);
+	s->pos = undo->pos;
+	s->growing = undo->growing;
+	s->length = undo->length;
+}
+
+// Counts the free cells the head can reach, stopping at `limit`
+int count_space(BotSearcher *s, int limit)
+{
+	GameState *state = s->bot->state;
+	int area = state->board_size.x * state->board_size.y;
+
+	// Cells visited in this count carry the current mark
+	if (++s->visit_mark == 0)
+	{
+		memset(s->visited, 0, area * sizeof(unsigned int));
+		s->visit_mark = 1;
+	}
+
+	int head = 0, tail = 0;
+	s->queue[tail++] = cell_index(state, s->pos);
+	s->visited[s->queue[0]] = s->visit_mark;
+	int count = 0;
+	while (head < tail && count < limit)
+	{
+		Coord cell = cell_coord(state, s->queue[head++]);
+		for (int move = 0; move < 4; move++)
+		{
+			Coord next;
+			if (!move_target(state, cell, move, &next))
+				continue;
+
+			unsigned int index = cell_index(state, next);
+			if (s->board[index] == EMPTY_CELL && s->visited[index] != s->visit_mark)
+			{
+				s->visited[index] = s->visit_mark;
+				s->queue[tail++] = index;
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+// Scores the position of the searcher with `depth` steps left to search
+int evaluate(BotSearcher *s, int depth, bool ate)
+{
+	GameState *state = s->bot->state;
+	int needed = s->length + s->growing;
+	int space = count_space(s, needed + BOT_SPACE_MARGIN);
+
+	// The snake can't fit into the space it can reach
+	if (space < needed)
+		return BOT_TRAPPED_SCORE + space * BOT_SPACE_WEIGHT;
+
+	if (ate)
+		return BOT_FOOD_SCORE * (state->superfood_counter == 0 ? BOT_SUPERFOOD_FACTOR : 1) +
+			   depth * BOT_DEPTH_BONUS + space * BOT_SPACE_WEIGHT;
+
+	int dx = abs(s->pos.x - state->food_coord.x), dy = abs(s->pos.y - state->food_coord.y);
+	if (state->rules.open_bounds_flag)
+	{
+		dx = (dx * 2 > state->board_size.x) ? state->board_size.x - dx : dx;
+		dy = (dy * 2 > state->board_size.y) ? state->board_size.y - dy : dy;
+	}
+	return space * BOT_SPACE_WEIGHT - dx - dy;
+}
+
+// Whether the searcher has to stop because of the deadline or the main searcher
+static inline bool should_stop(BotSearcher *s)
+{
+	Bot *bot = s->bot;
+	if (++s->nodes % BOT_DEADLINE_CHECK == 0 && bot->deadline != 0 && bot_now_ns() > bot->deadline)
+		__atomic_store_n(&bot->stop, 1, __ATOMIC_RELAXED);
+
+	s->stopped = __atomic_load_n(&bot->stop, __ATOMIC_RELAXED) != 0;
+	return s->stopped;
+}
+
+// Searches all move sequences of `depth` steps and returns the best score,
+// the first move of the best sequence is saved to `best_move`
+int search(BotSearcher *s, int depth, int *best_move)
+{
+	Bot *bot = s->bot;
+	GameState *state = bot->state;
+	*best_move = NO_MOVE;
+	if (should_stop(s))
+		return 0;
+
+	// Look up the position in the table
+	uint64_t key = s->hash ^
+				   zobrist_key(cell_index(state, s->pos), ZOBRIST_HEAD) ^
+				   zobrist_key(cell_index(state, state->food_coord), ZOBRIST_FOOD) ^
+				   zobrist_key(s->growing, BOT_GROWING_KEY);
+	BotEntry *entry = &bot->table[key & bot->table_mask];
+	uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+	uint64_t check = __atomic_load_n(&entry->key_xor_data, __ATOMIC_RELAXED);
+	int table_move = NO_MOVE;
+	if ((check ^ data) == key && (data & ENTRY_VALID))
+	{
+		table_move = (data >> ENTRY_MOVE_SHIFT) & 7;
+		if ((int)((data >> ENTRY_DEPTH_SHIFT) & 0xff) >= depth)
+		{
+			*best_move = table_move;
+			return (int32_t)(uint32_t)data;
+		}
+	}
+
+	// Without any move the snake dies, the later the better
+	int best = BOT_DEATH_SCORE - depth;
+	for (int i = -1; i < 4; i++)
+	{
+		// Try the move from the table first, then all in the order of the searcher
+		int move = (i < 0) ? table_move : (i + s->order) % 4;
+		if (move == NO_MOVE || (i >= 0 && move == table_move))
+			continue;
+
+		Coord target;
+		if (!move_target(state, s->pos, move, &target) || s->board[cell_index(state, target)] != EMPTY_CELL)
+			continue;
+
+		bool eats = target.x == state->food_coord.x && target.y == state->food_coord.y;
+		BotUndo undo;
+		make_move(s, target, eats, &undo);
+		int score, next_move;
+		if (eats || depth == 1)
+			score = evaluate(s, depth - 1, eats);
+		else
+			score = search(s, depth - 1, &next_move);
+		undo_move(s, &undo);
+
+		if (s->stopped)
+			return 0;
+		if (score > best || *best_move == NO_MOVE)
+		{
+			best = score;
+			*best_move = move;
+		}
+	}
+
+	data = ENTRY_VALID | ((uint64_t)*best_move << ENTRY_MOVE_SHIFT) |
+		   ((uint64_t)depth << ENTRY_DEPTH_SHIFT) | (uint32_t)best;
+	__atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->key_xor_data, key ^ data, __ATOMIC_RELAXED);
+	return best;
+}
+
+// Makes room for a board of `area` cells in the searcher, a buffer that was
+// already grown is kept if another one can't be
+// Returns `false` on error, `true` otherwise
+static bool grow_searcher(BotSearcher *s, int area)
+{
+	unsigned char *board = realloc(s->board, area * sizeof(unsigned char));
+	if (board == NULL)
+		return false;
+	s->board = board;
+
+	unsigned int *queue = realloc(s->queue, area * sizeof(unsigned int));
+	if (queue == NULL)
+		return false;
+	s->queue = queue;
+
+	unsigned int *visited = realloc(s->visited, area * sizeof(unsigned int));
+	if (visited == NULL)
+		return false;
+	s->visited = visited;
+
+	unsigned int *cells = realloc(s->cells, (BOT_MAX_DEPTH + 2) * 2 * sizeof(unsigned int));
+	if (cells == NULL)
+		return false;
+	s->cells = cells;
+
+	memset(s->visited, 0, area * sizeof(unsigned int));
+	s->visit_mark = 0;
+	s->capacity = area;
+	return true;
+}
+
+// Copies the round into the searcher and deepens the search until the
+// deadline or the maximum depth
+// Returns the best move of the deepest finished search
+int run_search(BotSearcher *s)
+{
+	GameState *state = s->bot->state;
+	int area = state->board_size.x * state->board_size.y;
+	// Without room for the board there is no move to search
+	if (area > s->capacity && !grow_searcher(s, area))
+	{
+		s->nodes = 0;
+		return NO_MOVE;
+	}
+	copy_board(state, s->board);
+
+	// The search pops at most one cell per step, so only the last cells of
+	// the snake are needed. If the snake is shorter than that, the cells the
+	// search pushes follow right after it.
+	int copied = (state->length < BOT_MAX_DEPTH + 1) ? state->length : BOT_MAX_DEPTH + 1;
+	for (int i = 0; i < copied; i++)
+		s->cells[i] = state->body[(state->body_tail + i) % state->body_capacity];
+	s->cells_tail = 0;
+	s->cells_head = copied - 1;
+	s->pos = state->pos;
+	s->growing = state->growing;
+	s->length = state->length;
+	s->hash = state->body_hash;
+	s->nodes = 0;
+	s->stopped = false;
+
+	int best_move = NO_MOVE;
+	int max_depth = (s->bot->deadline == 0) ? BOT_FIXED_DEPTH : BOT_MAX_DEPTH;
+	for (int depth = 1; depth <= max_depth; depth++)
+	{
+		int move;
+		int score = search(s, depth, &move);
+		if (s->stopped)
+			break;
+
+		best_move = move;
+		if (s == &s->bot->searchers[0])
+			s->bot->depth = depth;
+
+		// Nothing changes with more depth once every sequence dies
+		if (score <= BOT_DEATH_SCORE)
+			break;
+	}
+	return best_move;
+}
+
+void *run_helper(void *arg)
+{
+	BotSearcher *s = arg;
+	Bot *bot = s->bot;
+	long long seen = 0;
+
+	pthread_mutex_lock(&bot->lock);
+	while (true)
+	{
+		while (!bot->quit && bot->generation == seen)
+			pthread_cond_wait(&bot->start, &bot->lock);
+		if (bot->quit)
+			break;
+		seen = bot->generation;
+		pthread_mutex_unlock(&bot->lock);
+
+		run_search(s);
+
+		pthread_mutex_lock(&bot->lock);
+		if (--bot->running == 0)
+			pthread_cond_signal(&bot->done);
+	}
+	pthread_mutex_unlock(&bot->lock);
+	return NULL;
+}
+
+bool init_bot(Bot *bot, int threads)
+{
+	bot->threads = threads;
+	bot->table_mask = BOT_TABLE_SIZE - 1;
+	bot->table = calloc(BOT_TABLE_SIZE, sizeof(BotEntry));
+	bot->searchers = calloc(threads, sizeof(BotSearcher));
+	if (bot->table == NULL || bot->searchers == NULL)
+	{
+		free(bot->table);
+		free(bot->searchers);
+		return false;
+	}
+
+	bot->state = NULL;
+	bot->stop = 0;
+	bot->generation = 0;
+	bot->running = 0;
+	bot->quit = false;
+	bot->depth = 0;
+	bot->nodes = 0;
+	pthread_mutex_init(&bot->lock, NULL);
+	pthread_cond_init(&bot->start, NULL);
+	pthread_cond_init(&bot->done, NULL);
+
+	// The thread calling `bot_move` is the first searcher
+	for (int i = 0; i < threads; i++)
+	{
+		bot->searchers[i].bot = bot;
+		bot->searchers[i].order = i;
+	}
+	for (int i = 1; i < threads; i++)
+	{
+		if (pthread_create(&bot->searchers[i].thread, NULL, run_helper, &bot->searchers[i]) != 0)
+		{
+			bot->threads = i;
+			break;
+		}
+	}
+	return true;
+}
+
+void clear_bot(Bot *bot)
+{
+	memset(bot->table, 0, (bot->table_mask + 1) * sizeof(BotEntry));
+}
+
+UserInteraction bot_move(Bot *bot, GameState *state, long long budget)
+{
+	bot->state = state;
+	bot->deadline = (budget > 0) ? bot_now_ns() + budget : 0;
+	__atomic_store_n(&bot->stop, 0, __ATOMIC_RELAXED);
+
+	// Start the helpers
+	pthread_mutex_lock(&bot->lock);
+	bot->generation++;
+	bot->running = bot->threads - 1;
+	pthread_cond_broadcast(&bot->start);
+	pthread_mutex_unlock(&bot->lock);
+
+	int move = run_search(&bot->searchers[0]);
+
+	// Stop the helpers and wait for them to leave the position
+	__atomic_store_n(&bot->stop, 1, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&bot->lock);
+	while (bot->running > 0)
+		pthread_cond_wait(&bot->done, &bot->lock);
+	pthread_mutex_unlock(&bot->lock);
+
+	bot->nodes = 0;
+	for (int i = 0; i < bot->threads; i++)
+		bot->nodes += bot->searchers[i].nodes;
+	bot->state = NULL;
+
+	return (move == NO_MOVE) ? NO_INPUT : move_inputs[move];
+}
+
+void free_bot(Bot *bot)
+{
+	pthread_mutex_lock(&bot->lock);
+	bot->quit = true;
+	pthread_cond_broadcast(&bot->start);
+	pthread_mutex_unlock(&bot->lock);
+	for (int i = 1; i < bot->threads; i++)
+		pthread_join(bot->searchers[i].thread, NULL);
+
+	for (int i = 0; i < bot->threads; i++)
+	{
+		free(bot->searchers[i].board);
+		free(bot->searchers[i].cells);
+		free(bot->searchers[i].queue);
+		free(bot->searchers[i].visited);
+	}
+	free(bot->searchers);
+	free(bot->table);
+	pthread_mutex_destroy(&bot->lock);
+	pthread_cond_destroy(&bot->start);
+	pthread_cond_destroy(&bot->done);
+}
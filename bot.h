@@ -0,0 +1,110 @@
+// Computer player that searches several steps ahead
+// The bot tries every sequence of moves up to a depth and scores where they
+// end: dying is worst, eating the food is best (the sooner the better),
+// otherwise the amount of cells the head can still reach counts, with the
+// distance to the food as a tie-breaker.
+//
+// The search deepens iteratively until the deadline of the step, which the
+// frontend derives from the wait time of the round, and the best move of the
+// deepest finished search is played. All threads of the bot search the same
+// position (each trying the moves in another order) and share a
+// transposition table keyed by `state_hash` and the growth of the snake, so
+// they skip positions another thread already scored. Entries are stored as
+// two words, the key xor-ed with the data, so torn entries are detected
+// without locks.
+
+#ifndef BOT_H
+#define BOT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "engine.h"
+
+// Maximum amount of steps the bot looks ahead
+#define BOT_MAX_DEPTH 12
+// Steps the bot looks ahead when it has no time limit
+#define BOT_FIXED_DEPTH 6
+// Share of the wait time of a step the bot should search for, in percent
+#define BOT_TIME_SHARE 50
+
+typedef struct BotEntry
+{
+	uint64_t key_xor_data;
+	uint64_t data;
+} BotEntry;
+
+// State of a searching thread
+typedef struct BotSearcher
+{
+	struct Bot *bot;
+	pthread_t thread;
+	// Offset for the order in which moves are tried
+	int order;
+	// Copy of the occupancy grid the moves are made on, for boards of up to
+	// `capacity` cells
+	unsigned char *board;
+	int capacity;
+	// Cells of the snake from the tail on, including the heads pushed by the search
+	unsigned int *cells;
+	int cells_tail;
+	int cells_head;
+	// Position, length, growth and hash of the snake during the search
+	Coord pos;
+	int length;
+	int growing;
+	uint64_t hash;
+	// Scratch space for counting reachable cells
+	unsigned int *queue;
+	unsigned int *visited;
+	unsigned int visit_mark;
+	// Amount of positions searched in the current step
+	long long nodes;
+	// Whether the last search was stopped before it finished
+	bool stopped;
+} BotSearcher;
+
+typedef struct Bot
+{
+	BotSearcher *searchers;
+	int threads;
+	// Shared transposition table with `table_mask + 1` entries
+	BotEntry *table;
+	uint64_t table_mask;
+	// The position to search, only valid while a search runs
+	GameState *state;
+	// Time (in ns of CLOCK_MONOTONIC) the search has to end at, 0 for none
+	long long deadline;
+	// Set when the searchers have to stop
+	int stop;
+	// Helper threads wait for `generation` to change to start a search
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	long long generation;
+	int running;
+	bool quit;
+	// Statistics of the last step
+	int depth;
+	long long nodes;
+} Bot;
+
+// Prepares a bot searching on `threads` threads
+// Returns `false` on error, `true` otherwise
+bool init_bot(Bot *bot, int threads);
+
+// Forgets the positions searched in earlier rounds
+void clear_bot(Bot *bot);
+
+// Searches the best input for the next step of the round for `budget` ns
+// The bot keeps a copy of the whole board, so it only plays on dense boards
+// (see `GameState`).
+// With a budget of 0 the bot searches `BOT_FIXED_DEPTH` steps ahead instead,
+// so its moves don't depend on the speed of the machine.
+UserInteraction bot_move(Bot *bot, GameState *state, long long budget);
+
+// Stops the threads of the bot and frees its memory
+void free_bot(Bot *bot);
+
+#endif
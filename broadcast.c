@@ -0,0 +1,669 @@
+// we are using sockets from POSIX
+// see here: https://www.gnu.org/software/libc/manual/html_node/Feature-Test-Macros.html#index-_005fPOSIX_005fC_005fSOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "broadcast.h"
+
+// Bits of the flags of a keyframe
+#define KEYFRAME_OPEN_BOUNDS 1
+#define KEYFRAME_WALLS 2
+#define KEYFRAME_SUPERFOOD 4
+
+// Bytes read from the socket at once
+#define RECEIVE_SIZE (64 * 1024)
+
+// Fields of a message that is read
+typedef struct Reader
+{
+	const unsigned char *data;
+	size_t left;
+} Reader;
+
+// Makes room for `extra` more bytes in `buffer`
+static void reserve(MessageBuffer *buffer, size_t extra)
+{
+	if (buffer->length + extra <= buffer->capacity)
+		return;
+
+	size_t capacity = (buffer->capacity > 0) ? buffer->capacity : 256;
+	while (capacity < buffer->length + extra)
+		capacity *= 2;
+	unsigned char *data = realloc(buffer->data, capacity);
+	if (data == NULL)
+	{
+		fprintf(stderr, "Unable to allocate the broadcast\n");
+		abort();
+	}
+	buffer->data = data;
+	buffer->capacity = capacity;
+}
+
+static void put(MessageBuffer *buffer, const void *value, size_t size)
+{
+	reserve(buffer, size);
+	memcpy(buffer->data + buffer->length, value, size);
+	buffer->length += size;
+}
+
+static void put_int64(MessageBuffer *buffer, int64_t value)
+{
+	put(buffer, &value, sizeof(value));
+}
+
+static void put_uint32(MessageBuffer *buffer, uint32_t value)
+{
+	put(buffer, &value, sizeof(value));
+}
+
+static void put_uint8(MessageBuffer *buffer, uint8_t value)
+{
+	put(buffer, &value, sizeof(value));
+}
+
+// Starts `buffer` over with the header of a message of `type`
+static void begin_message(MessageBuffer *buffer, BroadcastMessage type)
+{
+	unsigned char header[BROADCAST_HEADER_SIZE] = {0};
+	header[4] = type;
+	buffer->length = 0;
+	put(buffer, header, sizeof(header));
+}
+
+// Writes the size of the message in `buffer` into its header
+static void end_message(MessageBuffer *buffer)
+{
+	uint32_t size = buffer->length;
+	memcpy(buffer->data, &size, sizeof(size));
+}
+
+// Size of the message starting at `data`
+static inline size_t message_size(const unsigned char *data)
+{
+	uint32_t size;
+	memcpy(&size, data, sizeof(size));
+	return size;
+}
+
+static bool take(Reader *reader, void *value, size_t size)
+{
+	if (reader->left < size)
+		return false;
+
+	memcpy(value, reader->data, size);
+	reader->data += size;
+	reader->left -= size;
+	return true;
+}
+
+static bool set_nonblocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Fills `address` with `path`
+// Returns `false` if the path is too long for a socket, `true` otherwise
+static bool socket_address(struct sockaddr_un *address, const char *path)
+{
+	memset(address, 0, sizeof(struct sockaddr_un));
+	address->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address->sun_path))
+		return false;
+
+	strcpy(address->sun_path, path);
+	return true;
+}
+
+bool open_broadcast(Broadcast *broadcast, const char *path)
+{
+	memset(broadcast, 0, sizeof(Broadcast));
+	broadcast->fd = -1;
+
+	struct sockaddr_un address;
+	if (!socket_address(&address, path))
+		return false;
+
+	// A socket left behind by a game that didn't end cleanly is replaced,
+	// anything else at the path is kept
+	struct stat info;
+	if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+		unlink(path);
+
+	broadcast->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (broadcast->fd < 0)
+		return false;
+
+	if (bind(broadcast->fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+		listen(broadcast->fd, SOMAXCONN) != 0 || !set_nonblocking(broadcast->fd))
+	{
+		close(broadcast->fd);
+		broadcast->fd = -1;
+		return false;
+	}
+
+	broadcast->path = strdup(path);
+	return true;
+}
+
+void close_broadcast(Broadcast *broadcast)
+{
+	if (broadcast->fd < 0)
+		return;
+
+	for (int i = 0; i < broadcast->subscriber_count; i++)
+	{
+		close(broadcast->subscribers[i].fd);
+		free(broadcast->subscribers[i].queue.data);
+	}
+	free(broadcast->subscribers);
+	free(broadcast->delta.data);
+	free(broadcast->keyframe.data);
+
+	close(broadcast->fd);
+	if (broadcast->path != NULL)
+		unlink(broadcast->path);
+	free(broadcast->path);
+	memset(broadcast, 0, sizeof(Broadcast));
+	broadcast->fd = -1;
+}
+
+// Writes the queue of `subscriber` as far as the socket takes it
+// Returns `false` if the connection is closed, `true` otherwise
+static bool flush_subscriber(Subscriber *subscriber)
+{
+	MessageBuffer *queue = &subscriber->queue;
+	while (subscriber->sent < queue->length)
+	{
+		ssize_t written = send(subscriber->fd, queue->data + subscriber->sent, queue->length - subscriber->sent, MSG_NOSIGNAL);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (written < 0)
+			return false;
+		subscriber->sent += written;
+	}
+
+	// Remove the messages that were written completely, so the first
+	// message of the queue is the one being written
+	size_t start = 0;
+	while (start < queue->length && start + message_size(queue->data + start) <= subscriber->sent)
+		start += message_size(queue->data + start);
+	if (start > 0)
+	{
+		memmove(queue->data, queue->data + start, queue->length - start);
+		queue->length -= start;
+		subscriber->sent -= start;
+		subscriber->keyframe_end = (subscriber->keyframe_end > start) ? subscriber->keyframe_end - start : 0;
+	}
+	return true;
+}
+
+// Drops all messages queued for `subscriber` except the one being written,
+// it gets a keyframe once that one is written
+static void drop_to_keyframe(Subscriber *subscriber)
+{
+	size_t kept = (subscriber->sent > 0) ? message_size(subscriber->queue.data) : 0;
+	subscriber->queue.length = kept;
+	subscriber->keyframe_end = (subscriber->keyframe_end < kept) ? subscriber->keyframe_end : kept;
+	subscriber->waiting = true;
+}
+
+static void remove_subscriber(Broadcast *broadcast, int index)
+{
+	close(broadcast->subscribers[index].fd);
+	free(broadcast->subscribers[index].queue.data);
+	broadcast->subscribers[index] = broadcast->subscribers[--broadcast->subscriber_count];
+}
+
+static void accept_subscribers(Broadcast *broadcast)
+{
+	while (true)
+	{
+		int fd = accept(broadcast->fd, NULL, NULL);
+		if (fd < 0 && errno == EINTR)
+			continue;
+		if (fd < 0)
+			return;
+		if (!set_nonblocking(fd))
+		{
+			close(fd);
+			continue;
+		}
+
+		if (broadcast->subscriber_count == broadcast->subscriber_capacity)
+		{
+			int capacity = (broadcast->subscriber_capacity > 0) ? 2 * broadcast->subscriber_capacity : 8;
+			Subscriber *subscribers = realloc(broadcast->subscribers, capacity * sizeof(Subscriber));
+			if (subscribers == NULL)
+			{
+				close(fd);
+				return;
+			}
+			broadcast->subscribers = subscribers;
+			broadcast->subscriber_capacity = capacity;
+		}
+
+		Subscriber *subscriber = &broadcast->subscribers[broadcast->subscriber_count++];
+		memset(subscriber, 0, sizeof(Subscriber));
+		subscriber->fd = fd;
+		subscriber->waiting = true;
+	}
+}
+
+// Remembers what the subscribers know after a keyframe of `state` or the
+// delta of its last step
+static void take_snapshot(Broadcast *broadcast, GameState *state)
+{
+	broadcast->ticks = state->ticks;
+	broadcast->head = cell_coord(state, state->body[state->body_head]);
+	broadcast->food = state->food_coord;
+	broadcast->superfood = state->superfood_counter == 0;
+	broadcast->points = state->points;
+	broadcast->started = state->round_start >= 0;
+}
+
+static void build_keyframe(MessageBuffer *buffer, GameState *state)
+{
+	begin_message(buffer, BROADCAST_KEYFRAME);
+	put_int64(buffer, state->ticks);
+	put_int64(buffer, state->clock);
+	put_int64(buffer, state->round_start);
+	put_int64(buffer, state->food_time);
+	put_int64(buffer, state->points);
+	put_uint32(buffer, state->board_size.x);
+	put_uint32(buffer, state->board_size.y);
+	put_uint8(buffer, (state->rules.open_bounds_flag ? KEYFRAME_OPEN_BOUNDS : 0) |
+						  (state->rules.wall_flag ? KEYFRAME_WALLS : 0) |
+						  ((state->superfood_counter == 0) ? KEYFRAME_SUPERFOOD : 0));
+	put_uint8(buffer, state->rules.wall_pattern);
+	put_uint32(buffer, cell_index(state, state->food_coord));
+
+	// The cells of the snake are copied from its ring buffer in one or two runs
+	int count = (state->body_head - state->body_tail + state->body_capacity) % state->body_capacity + 1;
+	put_uint32(buffer, count);
+	int first_run = (state->body_tail + count <= state->body_capacity) ? count : state->body_capacity - state->body_tail;
+	put(buffer, state->body + state->body_tail, first_run * sizeof(unsigned int));
+	put(buffer, state->body, (count - first_run) * sizeof(unsigned int));
+	end_message(buffer);
+}
+
+void broadcast_round(Broadcast *broadcast, GameState *state)
+{
+	if (broadcast->fd < 0)
+		return;
+
+	take_snapshot(broadcast, state);
+	broadcast->ended = false;
+	for (int i = 0; i < broadcast->subscriber_count; i++)
+		drop_to_keyframe(&broadcast->subscribers[i]);
+	serve_broadcast(broadcast, state);
+}
+
+void broadcast_step(Broadcast *broadcast, GameState *state)
+{
+	if (broadcast->fd < 0 || state->ticks == broadcast->ticks)
+		return;
+
+	// The head is taken from the body, a head that hit something is not part
+	// of the snake
+	Coord head = cell_coord(state, state->body[state->body_head]);
+	bool superfood = state->superfood_counter == 0;
+	uint8_t changes = (state->tail_moved ? DELTA_TAIL : 0) |
+					  ((head.x != broadcast->head.x || head.y != broadcast->head.y) ? DELTA_HEAD : 0) |
+					  ((state->food_coord.x != broadcast->food.x || state->food_coord.y != broadcast->food.y ||
+						superfood != broadcast->superfood)
+						   ? DELTA_FOOD
+						   : 0) |
+					  ((state->points != broadcast->points) ? DELTA_SCORE : 0) |
+					  ((state->round_start >= 0 && !broadcast->started) ? DELTA_START : 0);
+	take_snapshot(broadcast, state);
+
+	MessageBuffer *delta = &broadcast->delta;
+	begin_message(delta, BROADCAST_DELTA);
+	put_int64(delta, state->ticks);
+	put_int64(delta, state->clock);
+	put_uint8(delta, changes);
+	if (changes & DELTA_HEAD)
+	{
+		put_uint32(delta, cell_index(state, head));
+	}
+	if (changes & DELTA_FOOD)
+	{
+		put_uint32(delta, cell_index(state, state->food_coord));
+		put_uint8(delta, superfood);
+		put_int64(delta, state->food_time);
+	}
+	if (changes & DELTA_SCORE)
+	{
+		put_int64(delta, state->points);
+	}
+	end_message(delta);
+
+	for (int i = 0; i < broadcast->subscriber_count; i++)
+	{
+		Subscriber *subscriber = &broadcast->subscribers[i];
+		if (subscriber->waiting)
+			continue;
+
+		// Deltas queued behind the keyframe are what the subscriber lags behind
+		size_t written = (subscriber->sent > subscriber->keyframe_end) ? subscriber->sent : subscriber->keyframe_end;
+		if (subscriber->queue.length - written + delta->length > SUBSCRIBER_BACKLOG_LIMIT)
+		{
+			drop_to_keyframe(subscriber);
+		}
+		else
+		{
+			put(&subscriber->queue, delta->data, delta->length);
+		}
+	}
+}
+
+void broadcast_end(Broadcast *broadcast, RoundEnd end)
+{
+	if (broadcast->fd < 0)
+		return;
+
+	broadcast->ended = true;
+	MessageBuffer *message = &broadcast->delta;
+	begin_message(message, BROADCAST_END);
+	put_uint8(message, end);
+	end_message(message);
+
+	for (int i = 0; i < broadcast->subscriber_count; i++)
+	{
+		Subscriber *subscriber = &broadcast->subscribers[i];
+		if (!subscriber->waiting)
+			put(&subscriber->queue, message->data, message->length);
+		if (!flush_subscriber(subscriber))
+			remove_subscriber(broadcast, i--);
+	}
+}
+
+void serve_broadcast(Broadcast *broadcast, GameState *state)
+{
+	if (broadcast->fd < 0)
+		return;
+
+	accept_subscribers(broadcast);
+
+	// The keyframe is built for the first subscriber that needs it, after
+	// the last round ended it is followed by its end (the last delta built)
+	bool keyframe_built = false;
+	for (int i = 0; i < broadcast->subscriber_count; i++)
+	{
+		Subscriber *subscriber = &broadcast->subscribers[i];
+		bool connected = flush_subscriber(subscriber);
+		if (connected && subscriber->waiting && subscriber->queue.length == 0 && state != NULL)
+		{
+			if (!keyframe_built)
+			{
+				build_keyframe(&broadcast->keyframe, state);
+				keyframe_built = true;
+			}
+			put(&subscriber->queue, broadcast->keyframe.data, broadcast->keyframe.length);
+			if (broadcast->ended)
+				put(&subscriber->queue, broadcast->delta.data, broadcast->delta.length);
+			subscriber->keyframe_end = subscriber->queue.length;
+			subscriber->waiting = false;
+			connected = flush_subscriber(subscriber);
+		}
+
+		if (!connected)
+			remove_subscriber(broadcast, i--);
+	}
+}
+
+int broadcast_poll_fds(const Broadcast *broadcast, struct pollfd *fds)
+{
+	if (broadcast->fd < 0)
+		return 0;
+
+	int count = 0;
+	fds[count].fd = broadcast->fd;
+	fds[count++].events = POLLIN;
+	for (int i = 0; i < broadcast->subscriber_count; i++)
+	{
+		const Subscriber *subscriber = &broadcast->subscribers[i];
+		if (subscriber->sent < subscriber->queue.length)
+		{
+			fds[count].fd = subscriber->fd;
+			fds[count++].events = POLLOUT;
+		}
+	}
+	return count;
+}
+
+bool connect_spectator(Spectator *spectator, const char *path)
+{
+	memset(spectator, 0, sizeof(Spectator));
+	struct sockaddr_un address;
+	if (!socket_address(&address, path))
+		return false;
+
+	spectator->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (spectator->fd < 0)
+		return false;
+
+	if (connect(spectator->fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(spectator->fd);
+		spectator->fd = -1;
+		return false;
+	}
+	return true;
+}
+
+bool receive_broadcast(Spectator *spectator)
+{
+	// Messages that were applied are removed at once
+	MessageBuffer *received = &spectator->received;
+	memmove(received->data, received->data + spectator->applied, received->length - spectator->applied);
+	received->length -= spectator->applied;
+	spectator->applied = 0;
+	reserve(received, RECEIVE_SIZE);
+
+	ssize_t count;
+	do
+	{
+		count = recv(spectator->fd, received->data + received->length, received->capacity - received->length, 0);
+	} while (count < 0 && errno == EINTR);
+
+	if (count <= 0)
+		return false;
+	received->length += count;
+	return true;
+}
+
+// Replaces the round mirrored in `state` with the one of a keyframe
+// Returns `false` if the keyframe is invalid, `true` otherwise
+static bool apply_keyframe(Reader *reader, GameState *state)
+{
+	int64_t ticks, clock, round_start, food_time, points;
+	uint32_t width, height, food, count;
+	uint8_t flags, pattern;
+	if (!take(reader, &ticks, sizeof(ticks)) || !take(reader, &clock, sizeof(clock)) ||
+		!take(reader, &round_start, sizeof(round_start)) || !take(reader, &food_time, sizeof(food_time)) ||
+		!take(reader, &points, sizeof(points)) || !take(reader, &width, sizeof(width)) ||
+		!take(reader, &height, sizeof(height)) || !take(reader, &flags, sizeof(flags)) ||
+		!take(reader, &pattern, sizeof(pattern)) || !take(reader, &food, sizeof(food)) ||
+		!take(reader, &count, sizeof(count)))
+	{
+		return false;
+	}
+
+	uint64_t area = (uint64_t)width * height;
+	GameRules rules;
+	rules.open_bounds_flag = (flags & KEYFRAME_OPEN_BOUNDS) != 0;
+	rules.wall_flag = (flags & KEYFRAME_WALLS) != 0;
+	rules.wall_pattern = pattern;
+	if (width == 0 || height == 0 || width > MAX_BOARD_SIZE || height > MAX_BOARD_SIZE || food >= area ||
+		count == 0 || count > area || reader->left != (size_t)count * sizeof(uint32_t) ||
+		(rules.wall_flag && (pattern < 1 || pattern > 5)))
+	{
+		return false;
+	}
+
+	// The walls follow from the rules, the snake of the new round is replaced
+	// by the one of the keyframe
+	reset_state(state, coord(width, height), &rules, 0);
+	Coord first = state->pos;
+	bool covers_first = false;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t cell;
+		if (!take(reader, &cell, sizeof(cell)) || cell >= area)
+			return false;
+
+		Coord position = cell_coord(state, cell);
+		covers_first = covers_first || cell == cell_index(state, first);
+		state->old_pos = state->pos;
+		state->pos = position;
+		state->old_direction = state->direction;
+		state->direction = (i == 0) ? HOLD : step_direction(state, state->old_pos, position);
+		push_body(state, position);
+	}
+	pop_body(state);
+	if (covers_first)
+		set_cell(state, first, SNAKE_CELL);
+	if (count == 1)
+		state->old_pos = state->pos;
+	if (state->old_direction == HOLD)
+		state->old_direction = state->direction;
+
+	state->ticks = ticks;
+	state->clock = clock;
+	state->round_start = round_start;
+	state->food_time = food_time;
+	state->points = points;
+	state->length = count;
+	state->food_coord = cell_coord(state, food);
+	state->superfood_counter = (flags & KEYFRAME_SUPERFOOD) ? 0 : SUPERFOOD_COUNTER_VALUE;
+	return true;
+}
+
+// Applies the changes of a step to the round mirrored in `state`
+// Returns `false` if the delta is invalid, `true` otherwise
+static bool apply_delta(Reader *reader, GameState *state)
+{
+	int64_t ticks, clock;
+	uint8_t changes;
+	if (!take(reader, &ticks, sizeof(ticks)) || !take(reader, &clock, sizeof(clock)) ||
+		!take(reader, &changes, sizeof(changes)))
+	{
+		return false;
+	}
+	state->ticks = ticks;
+	state->clock = clock;
+	state->tail_moved = false;
+	uint64_t area = (uint64_t)state->board_size.x * state->board_size.y;
+
+	// The head is added before the tail is removed, as in `step_state`
+	if (changes & DELTA_HEAD)
+	{
+		uint32_t cell;
+		if (!take(reader, &cell, sizeof(cell)) || cell >= area)
+			return false;
+
+		state->old_pos = state->pos;
+		state->pos = cell_coord(state, cell);
+		state->old_direction = state->direction;
+		state->direction = step_direction(state, state->old_pos, state->pos);
+		push_body(state, state->pos);
+		state->length++;
+	}
+	if (changes & DELTA_TAIL)
+	{
+		if (state->length < 2)
+			return false;
+
+		state->old_tail = pop_body(state);
+		state->tail_moved = true;
+		state->length--;
+	}
+	if (changes & DELTA_FOOD)
+	{
+		uint32_t food;
+		uint8_t superfood;
+		int64_t food_time;
+		if (!take(reader, &food, sizeof(food)) || !take(reader, &superfood, sizeof(superfood)) ||
+			!take(reader, &food_time, sizeof(food_time)) || food >= area)
+		{
+			return false;
+		}
+		state->food_coord = cell_coord(state, food);
+		state->superfood_counter = superfood ? 0 : SUPERFOOD_COUNTER_VALUE;
+		state->food_time = food_time;
+	}
+	if (changes & DELTA_SCORE)
+	{
+		int64_t points;
+		if (!take(reader, &points, sizeof(points)))
+			return false;
+		state->points = points;
+	}
+	if (changes & DELTA_START)
+	{
+		state->round_start = clock;
+		state->food_time = clock;
+	}
+	return true;
+}
+
+BroadcastMessage apply_broadcast(Spectator *spectator, GameState *state, RoundEnd *end)
+{
+	const unsigned char *message = spectator->received.data + spectator->applied;
+	size_t left = spectator->received.length - spectator->applied;
+	if (left < BROADCAST_HEADER_SIZE)
+		return BROADCAST_NONE;
+
+	size_t size = message_size(message);
+	if (size < BROADCAST_HEADER_SIZE || size > BROADCAST_MAX_MESSAGE)
+		return BROADCAST_INVALID;
+	if (left < size)
+		return BROADCAST_NONE;
+
+	Reader reader;
+	reader.data = message + BROADCAST_HEADER_SIZE;
+	reader.left = size - BROADCAST_HEADER_SIZE;
+	BroadcastMessage type = message[4];
+	bool valid = false;
+	if (type == BROADCAST_KEYFRAME)
+	{
+		valid = apply_keyframe(&reader, state);
+		spectator->synced = valid;
+	}
+	else if (type == BROADCAST_DELTA)
+	{
+		valid = spectator->synced && apply_delta(&reader, state);
+	}
+	else if (type == BROADCAST_END)
+	{
+		uint8_t value;
+		valid = take(&reader, &value, sizeof(value)) && value <= END_QUIT;
+		*end = valid ? value : END_QUIT;
+	}
+
+	spectator->applied += size;
+	return valid ? type : BROADCAST_INVALID;
+}
+
+void close_spectator(Spectator *spectator)
+{
+	if (spectator->fd >= 0)
+		close(spectator->fd);
+	free(spectator->received.data);
+	memset(spectator, 0, sizeof(Spectator));
+	spectator->fd = -1;
+}
@@ -0,0 +1,163 @@
+// Live stream of the rounds played to spectators on the same machine
+// The game listens on a Unix domain socket. Every subscriber first gets a
+// keyframe holding the whole round and then one delta per step with what the
+// step changed. Sockets are written without blocking: a subscriber that falls
+// too far behind loses its queued deltas and gets a fresh keyframe once it
+// has read everything that was written to it, so it never stalls the game.
+//
+// Stream format (numbers in the byte order of the machine, without padding):
+//   header                  size of the message with the header (uint32),
+//                           `BroadcastMessage` (uint8), 3 reserved bytes
+//   keyframe                ticks, clock, round start, food time, points (int64)
+//                           width, height (int32)
+//                           flags (uint8, bit 0: open bounds, bit 1: walls,
+//                           bit 2: superfood), wall pattern (uint8)
+//                           food, cell count (uint32)
+//                           cells of the snake from its tail to its head (uint32)
+//   delta                   ticks, clock (int64), changes (uint8, DELTA_* bits)
+//                           head (uint32, if DELTA_HEAD)
+//                           food (uint32), superfood (uint8), food time
+//                           (int64, if DELTA_FOOD)
+//                           points (int64, if DELTA_SCORE)
+//   end                     how the round ended (uint8, `RoundEnd`)
+// Cells are board indices (`y * width + x`).
+
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "engine.h"
+#include "history.h"
+
+#define BROADCAST_HEADER_SIZE 8
+// Largest message a spectator accepts, a keyframe of 16M cells
+#define BROADCAST_MAX_MESSAGE (1 << 26)
+// Bytes of deltas queued for a subscriber after which it is dropped to a keyframe
+#define SUBSCRIBER_BACKLOG_LIMIT (64 * 1024)
+
+// Bits of the changes of a delta
+#define DELTA_TAIL 1 // The last cell of the snake was removed
+#define DELTA_HEAD 2 // A new head was added to the snake
+#define DELTA_FOOD 4 // The food moved or became a superfood
+#define DELTA_SCORE 8 // The points changed
+#define DELTA_START 16 // The snake moved for the first time, the round timer starts
+
+typedef enum BroadcastMessage
+{
+	// No complete message has been received
+	BROADCAST_NONE,
+	BROADCAST_KEYFRAME,
+	BROADCAST_DELTA,
+	BROADCAST_END,
+	// The stream can't be read
+	BROADCAST_INVALID
+} BroadcastMessage;
+
+// Variable-sized buffer of messages
+typedef struct MessageBuffer
+{
+	unsigned char *data;
+	size_t length;
+	size_t capacity;
+} MessageBuffer;
+
+typedef struct Subscriber
+{
+	int fd;
+	// Messages not written to the socket yet, the first one may be written
+	// in part (up to `sent`)
+	MessageBuffer queue;
+	size_t sent;
+	// End of the keyframe in `queue`, deltas after it count as backlog
+	size_t keyframe_end;
+	// Whether the subscriber waits for a keyframe (no deltas are queued for it)
+	bool waiting;
+} Subscriber;
+
+typedef struct Broadcast
+{
+	// Listening socket (-1 if the game doesn't broadcast)
+	int fd;
+	// Path the socket is bound to
+	char *path;
+	Subscriber *subscribers;
+	int subscriber_count;
+	int subscriber_capacity;
+	// Delta of the last step and keyframe of the current state, built once
+	// for all subscribers
+	MessageBuffer delta;
+	MessageBuffer keyframe;
+	// The state the last delta brought the subscribers to, changes of a
+	// step are found by comparing against it
+	long long ticks;
+	Coord head;
+	Coord food;
+	bool superfood;
+	long long points;
+	bool started;
+	// Whether the last round ended, subscribers connecting until the next one
+	// starts get its final keyframe and its end (left in `delta`)
+	bool ended;
+} Broadcast;
+
+// A connection to a broadcasting game
+typedef struct Spectator
+{
+	int fd;
+	// Bytes received, the ones from `applied` on are not applied yet
+	MessageBuffer received;
+	size_t applied;
+	// Whether a keyframe has been applied, deltas need one
+	bool synced;
+} Spectator;
+
+// Starts listening for subscribers at `path`, replacing a stale socket
+// Returns `false` on error, `true` otherwise
+bool open_broadcast(Broadcast *broadcast, const char *path);
+
+// Closes all connections and removes the socket
+void close_broadcast(Broadcast *broadcast);
+
+// Starts a new round in `state`, every subscriber gets a keyframe of it
+void broadcast_round(Broadcast *broadcast, GameState *state);
+
+// Queues the changes of the last step of `state` for all subscribers
+// Does nothing if `state` didn't take a step since the last call.
+void broadcast_step(Broadcast *broadcast, GameState *state);
+
+// Queues the end of the round for all subscribers and writes it out
+void broadcast_end(Broadcast *broadcast, RoundEnd end);
+
+// Accepts new subscribers, queues keyframes of `state` for subscribers
+// waiting for one and writes as much as the sockets take without blocking
+// `state` is the round being played or the one that ended last, subscribers
+// keep waiting if it is `NULL`.
+void serve_broadcast(Broadcast *broadcast, GameState *state);
+
+// Fills `fds` with the sockets to serve once they are ready: the listening
+// socket and the subscribers with messages not written yet
+// `fds` needs room for one more entry than there are subscribers.
+// Returns the number of entries filled.
+int broadcast_poll_fds(const Broadcast *broadcast, struct pollfd *fds);
+
+// Connects to the broadcast at `path`
+// Returns `false` on error, `true` otherwise
+bool connect_spectator(Spectator *spectator, const char *path);
+
+// Reads what the socket has received, blocking until something arrives
+// Returns `false` if the stream ended or on error, `true` otherwise
+bool receive_broadcast(Spectator *spectator);
+
+// Applies the oldest complete message received to `state`, which mirrors the
+// broadcast round after a keyframe (`state` has to be zero-initialized before
+// the first one). After a delta, `tail_moved` and `old_tail` tell whether a
+// cell was removed from the snake, `end` is set by the end of a round.
+// Returns the type of the message applied.
+BroadcastMessage apply_broadcast(Spectator *spectator, GameState *state, RoundEnd *end);
+
+void close_spectator(Spectator *spectator);
+
+#endif
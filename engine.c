@@ -0,0 +1,953 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+
+void seed_rng(Rng *rng, uint64_t seed)
+{
+	// Initialization as done by the reference implementation, using the
+	// seed for the state and a fixed odd increment
+	rng->state = 0;
+	rng->inc = (0xda3e39cb94b95bdbULL << 1) | 1;
+	next_random(rng);
+	rng->state += seed;
+	next_random(rng);
+}
+
+uint32_t next_random(Rng *rng)
+{
+	uint64_t old = rng->state;
+	rng->state = old * 6364136223846793005ULL + rng->inc;
+	uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+	uint32_t rot = old >> 59;
+	return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+uint32_t random_below(Rng *rng, uint32_t bound)
+{
+	// Lemire's method: scale a 32 bit draw into [0, bound) by multiplication
+	// and reject the few low results that would make some values more likely
+	uint64_t m = (uint64_t)next_random(rng) * bound;
+	uint32_t low = (uint32_t)m;
+	if (low < bound)
+	{
+		uint32_t threshold = -bound % bound;
+		while (low < threshold)
+		{
+			m = (uint64_t)next_random(rng) * bound;
+			low = (uint32_t)m;
+		}
+	}
+	return m >> 32;
+}
+
+uint64_t next_seed(Rng *rng)
+{
+	uint64_t high = next_random(rng);
+	return (high << 32) | next_random(rng);
+}
+
+long long step_interval(const GameState *state)
+{
+	long long interval = (long long)state->wait_time * NANOSECS_IN_MILLISEC;
+	if (state->speed_up)
+	{
+		interval = interval / 3;
+	}
+	return interval;
+}
+
+int calculate_current_bonus(const GameState *state)
+{
+	// If the round hasn't started yet, return full bonus
+	if (state->round_start < 0)
+	{
+		return POINTS_COUNTER_VALUE;
+	}
+
+	// Convert to centiseconds for smooth decay calculation
+	long long elapsed_centis = (state->clock - state->food_time) / (10 * NANOSECS_IN_MILLISEC);
+	long long total_decay = (elapsed_centis * BONUS_DECAY_PER_SECOND) / 100;
+
+	int current_bonus = POINTS_COUNTER_VALUE - total_decay;
+	if (current_bonus < MIN_POINTS)
+	{
+		current_bonus = MIN_POINTS;
+	}
+	return current_bonus;
+}
+
+long long round_time(const GameState *state)
+{
+	return (state->round_start < 0) ? 0 : state->clock - state->round_start;
+}
+
+// Sets the content of the cell at the given coordinates and keeps the
+// set of free cells up to date
+// Cells outside of the board are ignored
+void set_cell(GameState *state, Coord cell, CellType type)
+{
+	if ((cell.x < 0) || (cell.y < 0) || (cell.x >= state->board_size.x) || (cell.y >= state->board_size.y))
+		return;
+
+	// Empty cells of missing chunks stay missing, other cells need their chunk
+	unsigned char ***row = &state->chunk_rows[cell.y >> CHUNK_SHIFT];
+	if (*row == NULL || (*row)[cell.x >> CHUNK_SHIFT] == NULL)
+	{
+		if (type == EMPTY_CELL)
+			return;
+
+		if (*row == NULL)
+			*row = calloc(state->chunk_count.x, sizeof(unsigned char *));
+		if (*row != NULL && (*row)[cell.x >> CHUNK_SHIFT] == NULL)
+			(*row)[cell.x >> CHUNK_SHIFT] = calloc(CHUNK_SIZE * CHUNK_SIZE, sizeof(unsigned char));
+		if (*row == NULL || (*row)[cell.x >> CHUNK_SHIFT] == NULL)
+		{
+			fprintf(stderr, "Unable to allocate the board\n");
+			abort();
+		}
+	}
+
+	unsigned char *content = &(*row)[cell.x >> CHUNK_SHIFT][((cell.y & (CHUNK_SIZE - 1)) << CHUNK_SHIFT) | (cell.x & (CHUNK_SIZE - 1))];
+	bool was_free = *content == EMPTY_CELL;
+	*content = type;
+
+	if (was_free && type != EMPTY_CELL)
+	{
+		state->free_count--;
+		if (!state->dense)
+			return;
+
+		// Swap the last free cell into the slot of the occupied one
+		unsigned int index = cell_index(state, cell);
+		unsigned int moved = state->free_cells[state->free_count];
+		state->free_cells[state->free_index[index]] = moved;
+		state->free_index[moved] = state->free_index[index];
+		state->free_bits[cell.y * state->board_words + cell.x / 64] &= ~(1ULL << (cell.x % 64));
+	}
+	else if (!was_free && type == EMPTY_CELL)
+	{
+		state->free_count++;
+		if (!state->dense)
+			return;
+
+		// Append the cell to the free cells
+		unsigned int index = cell_index(state, cell);
+		state->free_cells[state->free_count - 1] = index;
+		state->free_index[index] = state->free_count - 1;
+		state->free_bits[cell.y * state->board_words + cell.x / 64] |= 1ULL << (cell.x % 64);
+	}
+}
+
+// Doubles the capacity of the body of the snake, moving its cells to the
+// front of the new buffer in order from the tail to the head
+void grow_body(GameState *state)
+{
+	int count = state->body_capacity;
+	unsigned int *body = malloc(2 * (size_t)count * sizeof(unsigned int));
+	if (body == NULL)
+	{
+		fprintf(stderr, "Unable to allocate the snake\n");
+		abort();
+	}
+
+	for (int i = 0; i < count; i++)
+		body[i] = state->body[(state->body_tail + i) % count];
+	free(state->body);
+	state->body = body;
+	state->body_capacity = 2 * count;
+	state->body_tail = 0;
+	state->body_head = count - 1;
+}
+
+// Adds a new head at `cell` to the snake
+void push_body(GameState *state, Coord cell)
+{
+	// The snake always has a cell, so the body is full if the slot after the
+	// head is the tail
+	if ((state->body_head + 1) % state->body_capacity == state->body_tail)
+		grow_body(state);
+
+	if (++state->body_head == state->body_capacity)
+		state->body_head = 0;
+
+	state->body[state->body_head] = cell_index(state, cell);
+	state->body_hash ^= zobrist_key(state->body[state->body_head], ZOBRIST_BODY);
+	set_cell(state, cell, SNAKE_CELL);
+}
+
+// Removes the last cell of the snake and returns its coordinates
+Coord pop_body(GameState *state)
+{
+	Coord last = cell_coord(state, state->body[state->body_tail]);
+	state->body_hash ^= zobrist_key(state->body[state->body_tail], ZOBRIST_BODY);
+
+	if (++state->body_tail == state->body_capacity)
+		state->body_tail = 0;
+
+	set_cell(state, last, EMPTY_CELL);
+	return last;
+}
+
+bool is_on_obstacle(GameState *state, const int x, const int y)
+{
+	return get_cell(state, x, y) != EMPTY_CELL;
+}
+
+// Picks a random free cell of the board and saves it to `coord`
+// Returns `false` if the board is full, `true` otherwise
+bool new_random_coordinates(GameState *state, Coord *coord)
+{
+	if (state->free_count == 0)
+		return false;
+
+	if (state->dense)
+	{
+		*coord = cell_coord(state, state->free_cells[random_below(&state->rng, state->free_count)]);
+		return true;
+	}
+
+	// Every draw is a uniformly distributed cell, so the first free one is a
+	// uniformly distributed free cell
+	do
+	{
+		coord->x = random_below(&state->rng, state->board_size.x);
+		coord->y = random_below(&state->rng, state->board_size.y);
+	} while (get_cell(state, coord->x, coord->y) != EMPTY_CELL);
+	return true;
+}
+
+void copy_board(GameState *state, unsigned char *cells)
+{
+	int width = state->board_size.x;
+	for (int y = 0; y < state->board_size.y; y++)
+	{
+		unsigned char **row = state->chunk_rows[y >> CHUNK_SHIFT];
+		unsigned char *line = &cells[(size_t)y * width];
+		for (int x = 0; x < width; x += CHUNK_SIZE)
+		{
+			int run = (width - x < CHUNK_SIZE) ? width - x : CHUNK_SIZE;
+			unsigned char *chunk = (row != NULL) ? row[x >> CHUNK_SHIFT] : NULL;
+			if (chunk == NULL)
+				memset(&line[x], EMPTY_CELL, run);
+			else
+				memcpy(&line[x], &chunk[(y & (CHUNK_SIZE - 1)) << CHUNK_SHIFT], run);
+		}
+	}
+}
+
+static inline int count_bits(uint64_t word)
+{
+#ifdef __GNUC__
+	return __builtin_popcountll(word);
+#else
+	int count = 0;
+	for (; word != 0; word &= word - 1)
+		count++;
+	return count;
+#endif
+}
+
+static inline int lowest_bit(uint64_t word)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(word);
+#else
+	int bit = 0;
+	while (!(word & 1))
+	{
+		word >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+// Spreads the set bits of `reach` towards higher bits through the set bits of
+// `free` (occluded fill with logarithmic steps)
+static inline uint64_t fill_up(uint64_t reach, uint64_t free)
+{
+	reach |= free & (reach << 1);
+	free &= free << 1;
+	reach |= free & (reach << 2);
+	free &= free << 2;
+	reach |= free & (reach << 4);
+	free &= free << 4;
+	reach |= free & (reach << 8);
+	free &= free << 8;
+	reach |= free & (reach << 16);
+	free &= free << 16;
+	return reach | (free & (reach << 32));
+}
+
+// Spreads the set bits of `reach` towards lower bits through the set bits of `free`
+static inline uint64_t fill_down(uint64_t reach, uint64_t free)
+{
+	reach |= free & (reach >> 1);
+	free &= free >> 1;
+	reach |= free & (reach >> 2);
+	free &= free >> 2;
+	reach |= free & (reach >> 4);
+	free &= free >> 4;
+	reach |= free & (reach >> 8);
+	free &= free >> 8;
+	reach |= free & (reach >> 16);
+	free &= free >> 16;
+	return reach | (free & (reach >> 32));
+}
+
+// Spreads the cells added to word `word` of a row along the row as far as the
+// free cells go
+// The rest of the row has been spread before, so the fill stops at the first
+// word on either side that it doesn't change.
+static void fill_row(GameState *state, uint64_t *reach, const uint64_t *free, int word)
+{
+	int words = state->board_words;
+	int last_bit = (state->board_size.x - 1) % 64;
+
+	while (true)
+	{
+		uint64_t carry = 0;
+		for (int i = word; i < words; i++)
+		{
+			uint64_t filled = fill_up(reach[i] | (carry & free[i]), free[i]);
+			if (i > word && filled == reach[i])
+				break;
+			reach[i] = filled;
+			carry = filled >> 63;
+		}
+
+		carry = 0;
+		for (int i = word; i >= 0; i--)
+		{
+			uint64_t filled = fill_down(reach[i] | ((carry << 63) & free[i]), free[i]);
+			if (i < word && filled == reach[i])
+				break;
+			reach[i] = filled;
+			carry = filled & 1;
+		}
+
+		// With open bounds the ends of the row are neighbours
+		if (!state->rules.open_bounds_flag)
+			return;
+		uint64_t first_cell = reach[0] & 1, last_cell = (reach[words - 1] >> last_bit) & 1;
+		if (first_cell && !last_cell && (free[words - 1] >> last_bit) & 1)
+		{
+			reach[words - 1] |= 1ULL << last_bit;
+			word = words - 1;
+		}
+		else if (last_cell && !first_cell && (free[0] & 1))
+		{
+			reach[0] |= 1;
+			word = 0;
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+// Adds the free cells of `row` that are next to reached cells of `neighbour`
+// and spreads them along the row, only from the words they were added to
+// Returns whether any cell was added
+static inline bool spread_rows(GameState *state, uint64_t *restrict row, const uint64_t *restrict free, const uint64_t *restrict neighbour)
+{
+	bool added = false;
+	for (int i = 0; i < state->board_words; i++)
+	{
+		uint64_t spread = neighbour[i] & free[i] & ~row[i];
+		if (spread == 0)
+			continue;
+		row[i] |= spread;
+		added = true;
+
+		// Cells without a free cell next to them in the row (as in a corridor
+		// across the rows) don't spread, cells at the ends of the word may
+		uint64_t beside = ((spread << 1) | (spread >> 1)) & free[i] & ~row[i];
+		if (beside != 0 || (spread & (1 | 1ULL << 63)) != 0 || i == state->board_words - 1)
+			fill_row(state, row, free, i);
+	}
+	return added;
+}
+
+long long find_reachable(GameState *state)
+{
+	int words = state->board_words;
+	int height = state->board_size.y;
+	uint64_t *reach = state->reach_bits;
+	const uint64_t *free = state->free_bits;
+	for (int i = 0; i < words * height; i++)
+		reach[i] = 0;
+
+	// Start with the free neighbours of the head and spread them along their rows
+	const Coord offsets[] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+	for (int i = 0; i < 4; i++)
+	{
+		Coord cell = coord(state->pos.x + offsets[i].x, state->pos.y + offsets[i].y);
+		if (state->rules.open_bounds_flag)
+		{
+			cell.x = (cell.x + state->board_size.x) % state->board_size.x;
+			cell.y = (cell.y + state->board_size.y) % state->board_size.y;
+		}
+		if (cell.x < 0 || cell.y < 0 || cell.x >= state->board_size.x || cell.y >= state->board_size.y)
+			continue;
+
+		int word = cell.y * words + cell.x / 64;
+		reach[word] |= free[word] & (1ULL << (cell.x % 64));
+		fill_row(state, &reach[cell.y * words], &free[cell.y * words], cell.x / 64);
+	}
+
+	// Sweep down and up the board, spreading the cells reached in a row into
+	// the next one, until a pair of sweeps adds nothing. A row is only filled
+	// along from the words cells were spread into.
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (int y = 0; y < height; y++)
+		{
+			int above = (y > 0) ? y - 1 : (state->rules.open_bounds_flag ? height - 1 : -1);
+			if (above >= 0 && spread_rows(state, &reach[y * words], &free[y * words], &reach[above * words]))
+				changed = true;
+		}
+
+		for (int y = height - 1; y >= 0; y--)
+		{
+			int below = (y < height - 1) ? y + 1 : (state->rules.open_bounds_flag ? 0 : -1);
+			if (below >= 0 && spread_rows(state, &reach[y * words], &free[y * words], &reach[below * words]))
+				changed = true;
+		}
+	}
+
+	long long count = 0;
+	for (int i = 0; i < words * height; i++)
+		count += count_bits(reach[i]);
+	return count;
+}
+
+bool new_food_coordinates(GameState *state, Coord *coord)
+{
+	long long reachable = state->dense ? find_reachable(state) : 0;
+	if (reachable == 0)
+		return new_random_coordinates(state, coord);
+
+	// Find the word holding the chosen reachable cell, then the cell in it
+	long long chosen = random_below(&state->rng, reachable);
+	for (int i = 0;; i++)
+	{
+		uint64_t word = state->reach_bits[i];
+		int count = count_bits(word);
+		if (chosen >= count)
+		{
+			chosen -= count;
+			continue;
+		}
+
+		while (chosen-- > 0)
+			word &= word - 1;
+		coord->x = i % state->board_words * 64 + lowest_bit(word);
+		coord->y = i / state->board_words;
+		return true;
+	}
+}
+
+// Adds the wall that starts at `start` and runs in direction `dir` up to (but
+// not including) `end`, covering at least the start cell, as one segment
+// The segment is clipped to the board.
+void add_wall_segment(WallLayout *layout, int start, int end, int constant, Direction dir)
+{
+	// Lowest coordinate and length of the run along the axis of `dir`
+	int low, length;
+	if ((dir == DOWN) || (dir == RIGHT))
+	{
+		low = start;
+		length = (end - start > 1) ? end - start : 1;
+	}
+	else
+	{
+		length = (start - end > 1) ? start - end : 1;
+		low = start - length + 1;
+	}
+
+	bool vertical = (dir == UP) || (dir == DOWN);
+	int extent = vertical ? layout->size.y : layout->size.x;
+	int cross_extent = vertical ? layout->size.x : layout->size.y;
+	if (low < 0)
+	{
+		length += low;
+		low = 0;
+	}
+	if (low + length > extent)
+	{
+		length = extent - low;
+	}
+	if (length <= 0 || constant < 0 || constant >= cross_extent || layout->count == MAX_WALL_SEGMENTS)
+	{
+		return;
+	}
+
+	WallSegment *segment = &layout->segments[layout->count++];
+	segment->start = vertical ? coord(constant, low) : coord(low, constant);
+	segment->length = length;
+	segment->vertical = vertical;
+}
+
+bool update_position(GameState *state, Direction direction, Coord max_coord)
+{
+	switch (direction)
+	{
+	case UP:
+		state->pos.y--;
+		break;
+	case DOWN:
+		state->pos.y++;
+		break;
+	case LEFT:
+		state->pos.x--;
+		break;
+	case RIGHT:
+		state->pos.x++;
+		break;
+	case HOLD:
+		return false;
+	default:
+		break;
+	}
+
+	if (state->rules.open_bounds_flag)
+	{
+		// If you hit the outer bounds you'll end up on the other side
+		if (state->pos.y < 0)
+		{
+			state->pos.y = max_coord.y - 1;
+		}
+		else if (state->pos.y >= max_coord.y)
+		{
+			state->pos.y = 0;
+		}
+		else if (state->pos.x < 0)
+		{
+			state->pos.x = max_coord.x - 1;
+		}
+		else if (state->pos.x >= max_coord.x)
+		{
+			state->pos.x = 0;
+		}
+		return false;
+	}
+	else
+	{
+		return (state->pos.y < 0) || (state->pos.x < 0) || (state->pos.y >= max_coord.y) || (state->pos.x >= max_coord.x);
+	}
+}
+
+UserInteraction pop_current_input(GameState *state)
+{
+	InputQueue *queue = &state->input_queue;
+	if (queue->count == 0)
+	{
+		return NO_INPUT;
+	}
+
+	UserInteraction input = queue->inputs[queue->first];
+	queue->first = (queue->first + 1) % INPUT_QUEUE_CAPACITY;
+	queue->count--;
+	return input;
+}
+
+void check_speed_up(UserInteraction input, GameState *state)
+{
+	if ((input == DIRECTION_LEFT && state->direction == LEFT) ||
+		(input == DIRECTION_RIGHT && state->direction == RIGHT) ||
+		(input == DIRECTION_UP && state->direction == UP) ||
+		(input == DIRECTION_DOWN && state->direction == DOWN))
+	{
+		state->speed_up = true;
+	}
+	else if (input != NO_INPUT)
+	{
+		state->speed_up = false;
+	}
+}
+
+void push_input(UserInteraction input, GameState *state)
+{
+	if (input == NO_INPUT)
+	{
+		return;
+	}
+
+	InputQueue *queue = &state->input_queue;
+	if (queue->count > 0)
+	{
+		int last_index = (queue->first + queue->count - 1) % INPUT_QUEUE_CAPACITY;
+		UserInteraction last = queue->inputs[last_index];
+		if (last == input)
+		{
+			// We don't store the same input multiple times
+			return;
+		}
+		else if ((last == DIRECTION_LEFT && input == DIRECTION_RIGHT) ||
+				 (last == DIRECTION_RIGHT && input == DIRECTION_LEFT) ||
+				 (last == DIRECTION_UP && input == DIRECTION_DOWN) ||
+				 (last == DIRECTION_DOWN && input == DIRECTION_UP))
+		{
+			// We don't store opposite directions as they are illegal
+			return;
+		}
+
+		if (queue->count == INPUT_QUEUE_CAPACITY)
+		{
+			queue->dropped++;
+			if (input == PAUSE || input == RESTART || input == QUIT)
+			{
+				queue->inputs[last_index] = input;
+			}
+			return;
+		}
+	}
+
+	queue->inputs[(queue->first + queue->count) % INPUT_QUEUE_CAPACITY] = input;
+	queue->count++;
+}
+
+void init_wall(WallLayout *layout, Coord max_coord, const GameRules *rules)
+{
+	// The segments only depend on the pattern and the size of the board
+	short pattern = rules->wall_flag ? rules->wall_pattern : 0;
+	if (layout->valid && layout->pattern == pattern &&
+		layout->size.x == max_coord.x && layout->size.y == max_coord.y)
+	{
+		return;
+	}
+	layout->valid = true;
+	layout->pattern = pattern;
+	layout->size = max_coord;
+	layout->count = 0;
+
+	int max_x = max_coord.x;
+	int max_y = max_coord.y;
+	if (rules->wall_flag)
+	{
+		switch (rules->wall_pattern)
+		{
+		case 1:
+			add_wall_segment(layout, 0, max_y / 4, max_x / 2, DOWN);
+			add_wall_segment(layout, max_y, 3 * max_y / 4, max_x / 2, UP);
+			add_wall_segment(layout, 0, max_x / 4, max_y / 2, RIGHT);
+			add_wall_segment(layout, max_x, 3 * max_x / 4, max_y / 2, LEFT);
+			break;
+		case 2:
+			add_wall_segment(layout, max_y / 4, 3 * max_y / 4, max_x / 4, DOWN);
+			add_wall_segment(layout, max_y / 4, 3 * max_y / 4, 3 * max_x / 4, DOWN);
+			break;
+		case 3:
+			add_wall_segment(layout, max_x / 4, 3 * max_x / 4, max_y / 4, RIGHT);
+			add_wall_segment(layout, max_x / 4, 3 * max_x / 4, 3 * max_y / 4, RIGHT);
+			break;
+		case 4:
+			add_wall_segment(layout, max_y / 2 + 2, 3 * max_y / 4, max_x / 4, DOWN);
+			add_wall_segment(layout, max_y / 4, max_y / 2 - 1, max_x / 4, DOWN);
+			add_wall_segment(layout, max_y / 2 + 2, 3 * max_y / 4, 3 * max_x / 4, DOWN);
+			add_wall_segment(layout, max_y / 4, max_y / 2 - 1, 3 * max_x / 4, DOWN);
+			add_wall_segment(layout, max_x / 4, max_x / 2 - 1, max_y / 4, RIGHT);
+			add_wall_segment(layout, max_x / 4, max_x / 2 - 1, 3 * max_y / 4, RIGHT);
+			add_wall_segment(layout, max_x / 2 + 2, 3 * max_x / 4, max_y / 4, RIGHT);
+			add_wall_segment(layout, max_x / 2 + 2, 3 * max_x / 4 + 1, 3 * max_y / 4, RIGHT);
+			break;
+		case 5:
+			add_wall_segment(layout, 0, max_y / 4, max_x / 4, DOWN);
+			add_wall_segment(layout, 0, max_y / 4, 3 * max_x / 4, DOWN);
+			add_wall_segment(layout, 0, max_y / 4, max_x / 2, DOWN);
+			add_wall_segment(layout, max_y, 3 * max_y / 4, max_x / 4, UP);
+			add_wall_segment(layout, max_y, 3 * max_y / 4, 3 * max_x / 4, UP);
+			add_wall_segment(layout, max_y, 3 * max_y / 4, max_x / 2, UP);
+			add_wall_segment(layout, 0, max_x / 4, max_y / 2, RIGHT);
+			add_wall_segment(layout, max_x, 3 * max_x / 4, max_y / 2, LEFT);
+			break;
+		default:
+			fprintf(stderr, "Illegal wall pattern: %d\n", rules->wall_pattern);
+			abort();
+		}
+	}
+}
+
+void reset_state(GameState *state, Coord max_coord, const GameRules *rules, uint64_t seed)
+{
+	// Init gamestate
+	state->rules = *rules;
+	state->ticks = 0;
+	state->seed = seed;
+	seed_rng(&state->rng, seed);
+	state->points = 0;
+	state->direction = HOLD;
+	state->old_direction = HOLD;
+	state->grace_direction = HOLD;
+	state->wait_time = STARTING_WAIT_TIME;
+	state->pos.x = max_coord.x / 2;
+	state->pos.y = max_coord.y / 2;
+	state->old_pos = state->pos;
+	state->points_counter = POINTS_COUNTER_VALUE;
+	state->length = 1;
+	state->growing = STARTING_LENGTH - 1;
+	state->grace_frames = GRACE_FRAMES;
+	state->superfood_counter = SUPERFOOD_COUNTER_VALUE;
+	state->food_coord.x = 0;
+	state->food_coord.y = 0;
+	state->tail_moved = false;
+	state->old_tail = state->pos;
+	state->input_queue.first = 0;
+	state->input_queue.count = 0;
+	state->input_queue.dropped = 0;
+	state->speed_up = false;
+	state->clock = 0;
+	state->round_start = -1;
+	state->food_time = 0;
+
+	// Init wall, unless the last round already used the same one
+	init_wall(&state->walls, max_coord, rules);
+
+	// The buffers of the last round are reused if the board has the same size
+	long long area = (long long)max_coord.x * max_coord.y;
+	if (state->chunk_rows == NULL || state->board_size.x != max_coord.x || state->board_size.y != max_coord.y)
+	{
+		free_state(state);
+		state->chunk_count.x = (max_coord.x + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		state->chunk_count.y = (max_coord.y + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		state->chunk_rows = calloc(state->chunk_count.y, sizeof(unsigned char **));
+		state->body_capacity = (area < START_BODY_CAPACITY) ? area : START_BODY_CAPACITY;
+		state->body = malloc(state->body_capacity * sizeof(unsigned int));
+		state->dense = area <= DENSE_AREA_LIMIT;
+		if (state->dense)
+		{
+			state->free_cells = malloc(area * sizeof(unsigned int));
+			state->free_index = malloc(area * sizeof(unsigned int));
+			state->board_words = (max_coord.x + 63) / 64;
+			state->free_bits = malloc((size_t)state->board_words * max_coord.y * sizeof(uint64_t));
+			state->reach_bits = malloc((size_t)state->board_words * max_coord.y * sizeof(uint64_t));
+		}
+	}
+	else
+	{
+		// Empty the chunks of the last round, they are likely needed again
+		for (int y = 0; y < state->chunk_count.y; y++)
+		{
+			for (int x = 0; state->chunk_rows[y] != NULL && x < state->chunk_count.x; x++)
+			{
+				if (state->chunk_rows[y][x] != NULL)
+					memset(state->chunk_rows[y][x], EMPTY_CELL, CHUNK_SIZE * CHUNK_SIZE * sizeof(unsigned char));
+			}
+		}
+	}
+	state->board_size = max_coord;
+
+	// Init free cells, every cell is free at first
+	state->free_count = area;
+	if (state->dense)
+	{
+		for (int i = 0; i < state->free_count; i++)
+		{
+			state->free_cells[i] = i;
+			state->free_index[i] = i;
+		}
+		for (int y = 0; y < max_coord.y; y++)
+		{
+			uint64_t *row = &state->free_bits[y * state->board_words];
+			for (int i = 0; i < state->board_words; i++)
+				row[i] = ~0ULL;
+			// Bits past the end of the row are never free
+			if (max_coord.x % 64 != 0)
+				row[state->board_words - 1] = (1ULL << (max_coord.x % 64)) - 1;
+		}
+	}
+
+	// Create the body of the snake from its first cell
+	state->body_head = 0;
+	state->body_tail = 0;
+	state->body[0] = cell_index(state, state->pos);
+	state->body_hash = zobrist_key(state->body[0], ZOBRIST_BODY);
+	set_cell(state, state->pos, SNAKE_CELL);
+
+	// Mark the walls on the occupancy grid
+	for (int i = 0; i < state->walls.count; i++)
+	{
+		WallSegment *segment = &state->walls.segments[i];
+		for (int j = 0; j < segment->length; j++)
+		{
+			Coord cell = segment->start;
+			if (segment->vertical)
+				cell.y += j;
+			else
+				cell.x += j;
+			set_cell(state, cell, WALL_CELL);
+		}
+	}
+}
+
+GameState init_state(Coord max_coord, const GameRules *rules, uint64_t seed)
+{
+	GameState state;
+	state.chunk_rows = NULL;
+	state.free_cells = NULL;
+	state.free_index = NULL;
+	state.body = NULL;
+	state.free_bits = NULL;
+	state.reach_bits = NULL;
+	state.walls.valid = false;
+	reset_state(&state, max_coord, rules, seed);
+	return state;
+}
+
+void free_state(GameState *state)
+{
+	// Freeing memory used for the snake
+	free(state->body);
+	state->body = NULL;
+
+	// Freeing memory used for the occupancy grid and the free cells
+	for (int y = 0; state->chunk_rows != NULL && y < state->chunk_count.y; y++)
+	{
+		for (int x = 0; state->chunk_rows[y] != NULL && x < state->chunk_count.x; x++)
+			free(state->chunk_rows[y][x]);
+		free(state->chunk_rows[y]);
+	}
+	free(state->chunk_rows);
+	free(state->free_cells);
+	free(state->free_index);
+	free(state->free_bits);
+	free(state->reach_bits);
+	state->chunk_rows = NULL;
+	state->free_cells = NULL;
+	state->free_index = NULL;
+	state->free_bits = NULL;
+	state->reach_bits = NULL;
+}
+
+UpdateResult step_state(GameState *state, UserInteraction interaction)
+{
+	state->ticks++;
+	state->clock += step_interval(state);
+	state->tail_moved = false;
+
+	// Set direction from input
+	Direction direction_from_input = state->grace_direction == HOLD ? state->direction : state->grace_direction;
+	if (interaction == DIRECTION_LEFT && direction_from_input != RIGHT)
+	{
+		direction_from_input = LEFT;
+	}
+	else if (interaction == DIRECTION_RIGHT && direction_from_input != LEFT)
+	{
+		direction_from_input = RIGHT;
+	}
+	else if (interaction == DIRECTION_UP && direction_from_input != DOWN)
+	{
+		direction_from_input = UP;
+	}
+	else if (interaction == DIRECTION_DOWN && direction_from_input != UP)
+	{
+		direction_from_input = DOWN;
+	}
+
+	// No movement, so no update
+	if (direction_from_input == HOLD)
+	{
+		return NO_UPDATE;
+	}
+
+	// First movement, start the timers if they haven't started yet
+	if (state->round_start < 0)
+	{
+		state->round_start = state->clock;
+		state->food_time = state->clock;
+	}
+
+	// Save old coordinates
+	state->old_pos = state->pos;
+
+	// Update position and check if outer bounds were hit
+	bool wall_hit = update_position(state, direction_from_input, state->board_size);
+
+	// The snake hits something
+	if (wall_hit || is_on_obstacle(state, state->pos.x, state->pos.y))
+	{
+		if (state->grace_frames == 0)
+		{
+			// No grace frames left, game over
+			return GAME_OVER;
+		}
+		else
+		{
+			// We still have grace frames so we reset the coordinate and
+			// let the player change the direction
+			state->grace_frames--;
+			state->pos = state->old_pos;
+
+			state->grace_direction = direction_from_input;
+
+			return GRACE;
+		}
+	}
+
+	// Reset grace frames and direction
+	state->grace_frames = GRACE_FRAMES;
+	state->grace_direction = HOLD;
+
+	// Update directions
+	state->old_direction = state->direction;
+	state->direction = direction_from_input;
+
+	// Add new head to snake
+	push_body(state, state->pos);
+
+	// Head hits the food
+	if ((state->pos.x == state->food_coord.x) &&
+		(state->pos.y == state->food_coord.y))
+	{
+		// Calculate bonus based on elapsed time since food was spawned
+		int current_bonus = calculate_current_bonus(state);
+		// Let the snake grow and change the speed
+		state->growing +=
+			state->superfood_counter == 0 ? SUPERFOOD_GROW_FACTOR : GROW_FACTOR;
+		if (state->wait_time > MINIMUM_WAIT_TIME)
+		{
+			state->wait_time -= WAIT_TIME_DECREMENT;
+		}
+		state->points +=
+			(current_bonus +
+			 state->length + (STARTING_WAIT_TIME - state->wait_time) * 5) *
+			(state->superfood_counter == 0 ? 5 : 1);
+		state->superfood_counter =
+			(state->superfood_counter == 0) ? SUPERFOOD_COUNTER_VALUE : state->superfood_counter - 1;
+
+		// Spawn new food, if there is no space left the player has won
+		if (!new_food_coordinates(state, &state->food_coord))
+		{
+			// The snake grew into the last free cell, which counts to its length
+			state->growing--;
+			state->length++;
+			return BOARD_FULL;
+		}
+
+		// Record when this food was spawned for bonus decay calculation
+		state->food_time = state->clock;
+	}
+
+	// If the snake is not growing...
+	if (state->growing == 0)
+	{
+		// ...remove the last cell from the snake
+		state->old_tail = pop_body(state);
+		state->tail_moved = true;
+	}
+	else
+	{
+		// If the snake is growing and moving, just decrement 'growing'...
+		state->growing--;
+		// ...and increment 'length'
+		state->length++;
+	}
+
+	return CONTINUE;
+}
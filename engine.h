@@ -0,0 +1,418 @@
+// Game engine of C-Snake
+// Holds the rules of the game and the state of a round without depending on
+// a terminal, so rounds can be played by the ncurses frontend as well as
+// without any output at all.
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NANOSECS_IN_SEC 1000000000
+#define NANOSECS_IN_MILLISEC 1000000
+
+// Constants important for gameplay
+#define STARTING_WAIT_TIME 80
+#define WAIT_TIME_DECREMENT 1
+#define MINIMUM_WAIT_TIME 5
+#define STARTING_LENGTH 5
+#define POINTS_COUNTER_VALUE 999
+#define SUPERFOOD_COUNTER_VALUE 10
+#define MIN_POINTS 100
+#define BONUS_DECAY_PER_SECOND 50
+#define GROW_FACTOR 10
+#define SUPERFOOD_GROW_FACTOR 15
+#define GRACE_FRAMES 3
+#define MAX_WALL_SEGMENTS 8 // Most segments a wall pattern consists of
+#define INPUT_QUEUE_CAPACITY 8 // Inputs that can wait for their step, one is applied per step
+
+// Limits of the board
+#define MAX_BOARD_SIZE 65536 // Most cells of a side of the board
+#define DENSE_AREA_LIMIT (1 << 20) // Most cells of a board that gets the dense structures, see `GameState`
+#define CHUNK_SHIFT 6
+#define CHUNK_SIZE (1 << CHUNK_SHIFT) // Cells of a side of a chunk of the occupancy grid
+#define START_BODY_CAPACITY 1024 // Cells the body of the snake can hold before it has to grow
+
+// Kinds of Zobrist keys (digits of pi)
+#define ZOBRIST_BODY 0x243f6a8885a308d3ULL
+#define ZOBRIST_HEAD 0x13198a2e03707344ULL
+#define ZOBRIST_FOOD 0xa4093822299f31d0ULL
+
+typedef enum Direction
+{
+	// No direction, standing still
+	HOLD,
+	// Negative y direction
+	UP,
+	// Positive y direction
+	DOWN,
+	// Positive x direction
+	RIGHT,
+	// Negative x direction
+	LEFT
+} Direction;
+
+typedef enum UserInteraction
+{
+	// No interaction by the user
+	NO_INPUT,
+	// Request to pause the game
+	PAUSE,
+	// Request to restart the round
+	RESTART,
+	// Request to quit the program
+	QUIT,
+	// Direction button pressed
+	DIRECTION_LEFT,
+	DIRECTION_RIGHT,
+	DIRECTION_UP,
+	DIRECTION_DOWN
+} UserInteraction;
+
+typedef enum UpdateResult
+{
+	// Player was saved by a grace frame
+	GRACE,
+	// The round ends in a game over
+	GAME_OVER,
+	// The board is full, the round ends with the player winning
+	BOARD_FULL,
+	// The round may continue
+	CONTINUE,
+	// Game should pause
+	PAUSE_GAME,
+	// Game should be quit
+	QUIT_GAME,
+	// Game should restart
+	RESTART_GAME,
+	// No update to be made
+	NO_UPDATE
+} UpdateResult;
+
+typedef enum CellType
+{
+	// Nothing occupies the cell
+	EMPTY_CELL,
+	// A part of the snake occupies the cell
+	SNAKE_CELL,
+	// A wall occupies the cell
+	WALL_CELL
+} CellType;
+
+typedef struct Coord
+{
+	int x;
+	int y;
+} Coord;
+
+// A straight run of wall cells
+typedef struct WallSegment
+{
+	// Cell with the lowest coordinates
+	Coord start;
+	// Amount of cells
+	int length;
+	// Whether the run goes down from `start` (otherwise it goes right)
+	bool vertical;
+} WallSegment;
+
+// The walls of a pattern on a board of a certain size
+typedef struct WallLayout
+{
+	// Whether the segments below belong to `pattern` and `size`
+	bool valid;
+	// Wall pattern (0 if walls are disabled)
+	short pattern;
+	Coord size;
+	WallSegment segments[MAX_WALL_SEGMENTS];
+	// Amount of entries in `segments`
+	int count;
+} WallLayout;
+
+// Inputs waiting to be applied as a ring buffer
+// When the queue is full, new directions are dropped so the ones queued
+// before still apply in the order they were made. Pausing, restarting and
+// quitting must not get lost, so they replace the newest queued input instead.
+typedef struct InputQueue
+{
+	UserInteraction inputs[INPUT_QUEUE_CAPACITY];
+	// Index of the oldest input
+	int first;
+	// Amount of queued inputs
+	int count;
+	// Amount of inputs dropped because the queue was full
+	long long dropped;
+} InputQueue;
+
+// Random number generator (PCG32, see https://www.pcg-random.org)
+// Every round owns one, so rounds are reproducible from their seed and
+// independent of each other
+typedef struct Rng
+{
+	// Internal state, advanced by every draw
+	uint64_t state;
+	// Selects the stream of the generator (always odd)
+	uint64_t inc;
+} Rng;
+
+typedef struct GameRules
+{
+	// Specifies whether outer walls should be open
+	bool open_bounds_flag;
+	// Specifies whether a wall pattern (specified by `wall_pattern`) should be used
+	bool wall_flag;
+	// Selects a predefined pattern (if `wall_flag` is `true`)
+	short wall_pattern;
+} GameRules;
+
+typedef struct GameState
+{
+	// Rules the round is played with
+	GameRules rules;
+	// Amount of simulation steps taken so far
+	long long ticks;
+	// Seed the random number generator of the round was seeded with
+	uint64_t seed;
+	// Random number generator of the round
+	Rng rng;
+	// Current score
+	long long points;
+	// Current direction
+	Direction direction;
+	// Previous direction from the last update
+	Direction old_direction;
+	// Direction that caused a grace frame, to be repeated next frame if not overwritten
+	Direction grace_direction;
+	// Time (in ms) for an update to happen (determines game speed)
+	int wait_time;
+	// Current position of the snake head
+	Coord pos;
+	// Position of the snake head from the last update
+	Coord old_pos;
+	// Current "bonus" points that would be added if food was hit
+	int points_counter;
+	// Current length of the snake
+	int length;
+	// Current amount of cells the snake still needs to grow
+	int growing;
+	// Amount of available update cycles that
+	int grace_frames;
+	// Amount of update cycles needed until the food becomes a super food
+	int superfood_counter;
+	// Current position of the food
+	Coord food_coord;
+	// Set by a step that removed the last cell of the snake
+	bool tail_moved;
+	// Position of the last cell removed from the snake
+	Coord old_tail;
+	// Cells of the snake as a ring buffer of board indices (`y * board_size.x + x`)
+	// It doubles its capacity whenever the snake doesn't fit in anymore.
+	unsigned int *body;
+	// Amount of cells `body` can hold
+	int body_capacity;
+	// Index of the head of the snake in `body`
+	int body_head;
+	// Index of the last cell of the snake in `body`
+	int body_tail;
+	// Zobrist hash of the cells of the snake, see `state_hash`
+	uint64_t body_hash;
+	// Segments of all walls
+	WallLayout walls;
+	// Dimensions of the board the round is played on
+	Coord board_size;
+	// Occupancy grid holding one `CellType` per cell of the board, so
+	// collision checks don't have to walk the snake or the walls
+	// The grid is split into chunks of CHUNK_SIZE x CHUNK_SIZE cells that are
+	// only allocated once something occupies one of their cells, so its memory
+	// grows with the occupied area instead of the area of the board.
+	// `chunk_rows[y / CHUNK_SIZE][x / CHUNK_SIZE]` holds the cell at `x` and
+	// `y` in row-major order, missing rows and chunks are empty.
+	unsigned char ***chunk_rows;
+	// Amount of chunks along each side of the board
+	Coord chunk_count;
+	// Amount of cells that are neither snake nor wall
+	long long free_count;
+	// Whether the board has at most DENSE_AREA_LIMIT cells
+	// Only such boards keep the structures below, which need memory for every
+	// cell of the board. On larger boards, food is placed by drawing cells until
+	// a free one comes up (the snake covers a tiny part of such a board) and
+	// `find_reachable` is not available.
+	bool dense;
+	// Indices of all free cells, in no particular order
+	unsigned int *free_cells;
+	// Position of every free cell in `free_cells` (only valid for free cells)
+	unsigned int *free_index;
+	// Free cells as a bitboard: every row of the board is `board_words` 64 bit
+	// words, the cell at `x` is bit `x % 64` of word `x / 64` of its row
+	uint64_t *free_bits;
+	int board_words;
+	// Bitboard of the cells the head can reach, filled by `find_reachable`
+	uint64_t *reach_bits;
+	// All inputs made by the user to be processed
+	InputQueue input_queue;
+	// Determines whether the game should run faster based on user input
+	bool speed_up;
+	// Simulated time (in ns) of the round, every step advances it by the
+	// interval it was waited for (see `step_interval`). Time that is not
+	// stepped through, e.g. while the game is paused, doesn't count.
+	long long clock;
+	// Simulated time of the first movement, the round timer starts there
+	// (-1 while the snake has not moved yet)
+	long long round_start;
+	// Simulated time the current food was spawned at (for bonus decay calculation)
+	long long food_time;
+} GameState;
+
+static inline Coord coord(int x, int y)
+{
+	Coord coord;
+	coord.x = x;
+	coord.y = y;
+	return coord;
+}
+
+// Returns the content of the cell at the given coordinates
+// Cells outside of the board are reported as empty
+static inline CellType get_cell(GameState *state, const int x, const int y)
+{
+	if ((x < 0) || (y < 0) || (x >= state->board_size.x) || (y >= state->board_size.y))
+		return EMPTY_CELL;
+
+	unsigned char **row = state->chunk_rows[y >> CHUNK_SHIFT];
+	if (row == NULL || row[x >> CHUNK_SHIFT] == NULL)
+		return EMPTY_CELL;
+
+	return row[x >> CHUNK_SHIFT][((y & (CHUNK_SIZE - 1)) << CHUNK_SHIFT) | (x & (CHUNK_SIZE - 1))];
+}
+
+// Packs a coordinate into an index into the board
+// Boards have at most MAX_BOARD_SIZE x MAX_BOARD_SIZE cells, so every index
+// fits into 32 bits.
+static inline unsigned int cell_index(GameState *state, Coord cell)
+{
+	return (unsigned int)cell.y * state->board_size.x + cell.x;
+}
+
+// Unpacks an index into the board into a coordinate
+static inline Coord cell_coord(GameState *state, unsigned int index)
+{
+	return coord(index % state->board_size.x, index / state->board_size.x);
+}
+
+// Direction of the step from `from` to its neighbour `to`
+static inline Direction step_direction(GameState *state, Coord from, Coord to)
+{
+	if (from.y == to.y)
+	{
+		return (to.x == (from.x + 1) % state->board_size.x) ? RIGHT : LEFT;
+	}
+	return (to.y == (from.y + 1) % state->board_size.y) ? DOWN : UP;
+}
+
+// Random key of a cell for Zobrist hashing
+// Keys are computed from the index of the cell (SplitMix64) instead of being
+// looked up in a table, so they exist for boards of any size. `kind` tells
+// apart keys of the same cell for different contents.
+static inline uint64_t zobrist_key(unsigned int index, uint64_t kind)
+{
+	uint64_t z = kind + index * 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Hash of the position of the head, the cells of the snake and the food
+// The part for the snake is updated on every push and pop of a cell.
+static inline uint64_t state_hash(GameState *state)
+{
+	return state->body_hash ^
+		   zobrist_key(cell_index(state, state->pos), ZOBRIST_HEAD) ^
+		   zobrist_key(cell_index(state, state->food_coord), ZOBRIST_FOOD);
+}
+
+// Seeds the generator, equal seeds produce equal sequences
+void seed_rng(Rng *rng, uint64_t seed);
+
+// Draws 32 uniformly distributed random bits
+uint32_t next_random(Rng *rng);
+
+// Draws a uniformly distributed number in [0, bound) without modulo bias
+// `bound` must not be 0
+uint32_t random_below(Rng *rng, uint32_t bound);
+
+// Draws 64 random bits, e.g. to derive seeds from a generator
+uint64_t next_seed(Rng *rng);
+
+// Time (in ns) between two steps of the round (determines game speed)
+long long step_interval(const GameState *state);
+
+// Calculate current bonus based on the simulated time since food was spawned
+int calculate_current_bonus(const GameState *state);
+
+// Simulated time (in ns) since the first movement of the round, 0 before it
+long long round_time(const GameState *state);
+
+// Sets the content of the cell at the given coordinates and keeps the
+// set of free cells up to date
+void set_cell(GameState *state, Coord cell, CellType type);
+
+// Adds a new head at `cell` to the snake
+void push_body(GameState *state, Coord cell);
+
+// Removes the last cell of the snake and returns its coordinates
+Coord pop_body(GameState *state);
+
+bool is_on_obstacle(GameState *state, const int x, const int y);
+
+// Copies the occupancy grid into `cells`, one `CellType` per cell indexed by
+// `cell_index`, which must have room for every cell of the board
+void copy_board(GameState *state, unsigned char *cells);
+
+// Picks a random free cell of the board and saves it to `coord`
+// Returns `false` if the board is full, `true` otherwise
+bool new_random_coordinates(GameState *state, Coord *coord);
+
+// Marks all free cells the head can reach in `reach_bits` by flooding the
+// bitboard of free cells from the head, a whole word of cells at once
+// Only available on dense boards (see `GameState`).
+// Returns the amount of reachable cells.
+long long find_reachable(GameState *state);
+
+// Picks a random free cell the head can reach and saves it to `coord`
+// If the head can't reach any free cell or the board isn't dense, any free
+// cell is picked.
+// Returns `false` if the board is full, `true` otherwise
+bool new_food_coordinates(GameState *state, Coord *coord);
+
+// Derives the wall segments for the rules on a board of size `max_coord`
+// Does nothing if `layout` already holds them, so it can be kept across rounds
+void init_wall(WallLayout *layout, Coord max_coord, const GameRules *rules);
+
+// Queues an input, dropping repeats and direct opposites of the last queued input
+void push_input(UserInteraction input, GameState *state);
+
+// Takes the oldest queued input, `NO_INPUT` if there is none
+UserInteraction pop_current_input(GameState *state);
+
+void check_speed_up(UserInteraction input, GameState *state);
+
+// Creates the state for a new round on a board of size `max_coord`, which
+// may have up to MAX_BOARD_SIZE cells on each side
+// The round draws all random numbers from a generator seeded with `seed`
+GameState init_state(Coord max_coord, const GameRules *rules, uint64_t seed);
+
+// Starts a new round in an existing state like `init_state` does, reusing its
+// buffers and walls if the board size and rules allow it
+// `state` has to be created with `init_state` or be zero-initialized.
+void reset_state(GameState *state, Coord max_coord, const GameRules *rules, uint64_t seed);
+
+// Frees all memory held by a state created with `init_state` or `reset_state`
+void free_state(GameState *state);
+
+// Advances the round by one simulation step, moving the snake according
+// to `interaction` (which should be a direction or `NO_INPUT`)
+UpdateResult step_state(GameState *state, UserInteraction interaction);
+
+#endif
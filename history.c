@@ -0,0 +1,400 @@
+// we are using files and memory maps from POSIX
+// see here: https://www.gnu.org/software/libc/manual/html_node/Feature-Test-Macros.html#index-_005fPOSIX_005fC_005fSOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "history.h"
+#include "perf.h"
+
+// Configurations are told apart by their flags and wall pattern
+#define CONFIG_COUNT 256
+
+typedef struct ConfigStats
+{
+	long long rounds;
+	long long total_score;
+	// Best round played with the configuration
+	HistoryRecord best;
+} ConfigStats;
+
+typedef struct MonthStats
+{
+	int year;
+	int month;
+	long long rounds;
+	long long total_score;
+	long long best_score;
+	long long total_duration;
+} MonthStats;
+
+// Distribution of a value over all rounds
+typedef struct Distribution
+{
+	LogHistogram histogram;
+	long long min;
+	long long max;
+	long long total;
+} Distribution;
+
+typedef struct HistoryStats
+{
+	long long rounds;
+	long long ends[END_QUIT + 1];
+	ConfigStats configs[CONFIG_COUNT];
+	// Months in the order their first round was played
+	MonthStats *months;
+	int month_count;
+	int month_capacity;
+	// Range of timestamps [start, end) of the month of the last record, so
+	// the month of most records is known without converting their time
+	time_t month_start;
+	time_t month_end;
+	int month_index;
+	Distribution score;
+	Distribution length;
+	Distribution duration;
+	Distribution frame_p50;
+	Distribution frame_p99;
+} HistoryStats;
+
+// Locks or unlocks (with `type` F_UNLCK) the whole log for writing
+// Games appending at the same time take turns, so a record that is cut off
+// can be removed before the next one is written.
+// Returns `false` on error, `true` otherwise
+static bool lock_history(int fd, short type)
+{
+	struct flock lock;
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = type;
+	lock.l_whence = SEEK_SET;
+	int result;
+	do
+	{
+		result = fcntl(fd, F_SETLKW, &lock);
+	} while (result < 0 && errno == EINTR);
+	return result == 0;
+}
+
+bool open_history(History *history, const char *path)
+{
+	history->fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (history->fd < 0)
+	{
+		return false;
+	}
+
+	// A new log starts with the header, an existing one must have it. Games
+	// opening the log at the same time check it one after another, so only
+	// one of them writes the header.
+	struct stat info;
+	bool valid = lock_history(history->fd, F_WRLCK);
+	valid = valid && fstat(history->fd, &info) == 0;
+	if (valid && info.st_size == 0)
+	{
+		unsigned char header[HISTORY_HEADER_SIZE] = {0};
+		memcpy(header, HISTORY_MAGIC, strlen(HISTORY_MAGIC));
+		header[strlen(HISTORY_MAGIC)] = HISTORY_VERSION;
+		valid = write(history->fd, header, sizeof(header)) == sizeof(header);
+	}
+	else if (valid)
+	{
+		unsigned char header[HISTORY_HEADER_SIZE];
+		int fd = open(path, O_RDONLY);
+		valid = fd >= 0 && read(fd, header, sizeof(header)) == sizeof(header) &&
+				memcmp(header, HISTORY_MAGIC, strlen(HISTORY_MAGIC)) == 0 &&
+				header[strlen(HISTORY_MAGIC)] == HISTORY_VERSION;
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+
+		// A record cut off by a crash would shift every record appended
+		// after it, so it is removed
+		off_t records = (info.st_size - HISTORY_HEADER_SIZE) / sizeof(HistoryRecord);
+		off_t size = HISTORY_HEADER_SIZE + records * (off_t)sizeof(HistoryRecord);
+		valid = valid && (size == info.st_size || ftruncate(history->fd, size) == 0);
+	}
+
+	if (history->fd >= 0)
+	{
+		lock_history(history->fd, F_UNLCK);
+	}
+	if (!valid)
+	{
+		close_history(history);
+	}
+	return valid;
+}
+
+bool append_history(History *history, const HistoryRecord *record)
+{
+	if (history->fd < 0)
+	{
+		return false;
+	}
+
+	// The record is written to the end of the log while no other game
+	// appends, and removed again if it was only written in part, so the
+	// records after it don't get shifted
+	struct stat info;
+	if (!lock_history(history->fd, F_WRLCK))
+	{
+		return false;
+	}
+	bool written = fstat(history->fd, &info) == 0;
+	if (written)
+	{
+		ssize_t result;
+		do
+		{
+			result = write(history->fd, record, sizeof(HistoryRecord));
+		} while (result < 0 && errno == EINTR);
+		written = result == sizeof(HistoryRecord);
+		if (!written && result > 0 && ftruncate(history->fd, info.st_size) != 0)
+		{
+			// The log can't be repaired, so nothing is appended to it anymore
+			close(history->fd);
+			history->fd = -1;
+			return false;
+		}
+	}
+	lock_history(history->fd, F_UNLCK);
+	return written;
+}
+
+void close_history(History *history)
+{
+	if (history->fd >= 0)
+	{
+		close(history->fd);
+	}
+	history->fd = -1;
+}
+
+void add_to_distribution(Distribution *distribution, long long value, long long count)
+{
+	if (count == 0 || value < distribution->min)
+		distribution->min = value;
+	if (count == 0 || value > distribution->max)
+		distribution->max = value;
+	distribution->total += value;
+	add_log_sample(&distribution->histogram, value);
+}
+
+// Finds the month of `timestamp` in the stats, adding it if it is new
+// Returns the index of the month or -1 on error
+int month_of(HistoryStats *stats, time_t timestamp)
+{
+	if (stats->month_count > 0 && timestamp >= stats->month_start && timestamp < stats->month_end)
+	{
+		return stats->month_index;
+	}
+
+	struct tm date;
+	if (localtime_r(&timestamp, &date) == NULL)
+	{
+		return -1;
+	}
+
+	// Remember where the month starts and ends
+	struct tm bound = date;
+	bound.tm_mday = 1;
+	bound.tm_hour = bound.tm_min = bound.tm_sec = 0;
+	bound.tm_isdst = -1;
+	stats->month_start = mktime(&bound);
+	bound.tm_mon++;
+	bound.tm_isdst = -1;
+	stats->month_end = mktime(&bound);
+
+	int year = date.tm_year + 1900, month = date.tm_mon + 1;
+	for (int i = 0; i < stats->month_count; i++)
+	{
+		if (stats->months[i].year == year && stats->months[i].month == month)
+		{
+			stats->month_index = i;
+			return i;
+		}
+	}
+
+	if (stats->month_count == stats->month_capacity)
+	{
+		int capacity = stats->month_capacity > 0 ? 2 * stats->month_capacity : 64;
+		MonthStats *months = realloc(stats->months, capacity * sizeof(MonthStats));
+		if (months == NULL)
+		{
+			return -1;
+		}
+		stats->months = months;
+		stats->month_capacity = capacity;
+	}
+
+	MonthStats *entry = &stats->months[stats->month_count];
+	memset(entry, 0, sizeof(MonthStats));
+	entry->year = year;
+	entry->month = month;
+	stats->month_index = stats->month_count++;
+	return stats->month_index;
+}
+
+void add_record(HistoryStats *stats, const HistoryRecord *record)
+{
+	long long count = stats->rounds++;
+	if (record->end <= END_QUIT)
+	{
+		stats->ends[record->end]++;
+	}
+
+	ConfigStats *config = &stats->configs[(record->flags & 0xf) | ((record->wall_pattern & 0xf) << 4)];
+	if (config->rounds == 0 || record->score > config->best.score)
+	{
+		config->best = *record;
+	}
+	config->rounds++;
+	config->total_score += record->score;
+
+	int month = month_of(stats, record->timestamp);
+	if (month >= 0)
+	{
+		MonthStats *entry = &stats->months[month];
+		entry->rounds++;
+		entry->total_score += record->score;
+		entry->total_duration += record->duration;
+		entry->best_score = (record->score > entry->best_score) ? record->score : entry->best_score;
+	}
+
+	add_to_distribution(&stats->score, record->score, count);
+	add_to_distribution(&stats->length, record->length, count);
+	add_to_distribution(&stats->duration, record->duration, count);
+	add_to_distribution(&stats->frame_p50, record->frame_p50, count);
+	add_to_distribution(&stats->frame_p99, record->frame_p99, count);
+}
+
+// Describes the configuration of a round, e.g. "open bounds, walls 3, bot"
+void describe_config(char *buffer, size_t bufsize, int flags, int wall_pattern)
+{
+	snprintf(buffer, bufsize, "%s%s%.0d%s%s",
+			 (flags & HISTORY_OPEN_BOUNDS) ? "open bounds, " : "closed bounds, ",
+			 (flags & HISTORY_WALLS) ? "walls " : "no walls",
+			 (flags & HISTORY_WALLS) ? wall_pattern : 0,
+			 (flags & HISTORY_AUTOPILOT) ? ", autopilot" : "",
+			 (flags & HISTORY_BOT) ? ", bot" : "");
+}
+
+void print_round_distribution(FILE *file, const char *name, Distribution *distribution, long long count, bool duration)
+{
+	long long values[] = {distribution->min, distribution->total / count,
+						  log_percentile(&distribution->histogram, 50),
+						  log_percentile(&distribution->histogram, 90),
+						  log_percentile(&distribution->histogram, 99), distribution->max};
+
+	fprintf(file, "%-10s", name);
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		// Percentiles are only known up to their bucket of the histogram
+		values[i] = (values[i] < distribution->min) ? distribution->min : values[i];
+		values[i] = (values[i] > distribution->max) ? distribution->max : values[i];
+
+		char buffer[16];
+		if (duration)
+			format_duration(buffer, sizeof(buffer), values[i]);
+		else
+			snprintf(buffer, sizeof(buffer), "%lld", values[i]);
+		fprintf(file, " %12s", buffer);
+	}
+	fputc('\n', file);
+}
+
+void print_stats(HistoryStats *stats, FILE *file)
+{
+	fprintf(file, "rounds: %lld\ngame over: %lld\nboard full: %lld\nrestarted: %lld\nquit: %lld\n",
+			stats->rounds, stats->ends[END_GAME_OVER], stats->ends[END_BOARD_FULL],
+			stats->ends[END_RESTART], stats->ends[END_QUIT]);
+	if (stats->rounds == 0)
+		return;
+
+	fprintf(file, "\n%-40s %10s %12s %12s %12s\n", "best per configuration", "rounds", "mean", "best", "board");
+	for (int i = 0; i < CONFIG_COUNT; i++)
+	{
+		ConfigStats *config = &stats->configs[i];
+		if (config->rounds == 0)
+			continue;
+
+		char name[64], board[32];
+		describe_config(name, sizeof(name), config->best.flags, config->best.wall_pattern);
+		snprintf(board, sizeof(board), "%dx%d", config->best.board_width, config->best.board_height);
+		fprintf(file, "%-40s %10lld %12lld %12lld %12s\n", name, config->rounds,
+				config->total_score / config->rounds, (long long)config->best.score, board);
+	}
+
+	fprintf(file, "\n%-10s %10s %12s %12s %12s\n", "month", "rounds", "mean", "best", "played");
+	for (int i = 0; i < stats->month_count; i++)
+	{
+		MonthStats *month = &stats->months[i];
+		char played[16];
+		format_duration(played, sizeof(played), month->total_duration);
+		fprintf(file, "%04d-%02d    %10lld %12lld %12lld %12s\n", month->year, month->month, month->rounds,
+				month->total_score / month->rounds, month->best_score, played);
+	}
+
+	fprintf(file, "\n%-10s %12s %12s %12s %12s %12s %12s\n", "", "min", "mean", "p50", "p90", "p99", "max");
+	print_round_distribution(file, "score", &stats->score, stats->rounds, false);
+	print_round_distribution(file, "length", &stats->length, stats->rounds, false);
+	print_round_distribution(file, "duration", &stats->duration, stats->rounds, true);
+	print_round_distribution(file, "frame p50", &stats->frame_p50, stats->rounds, true);
+	print_round_distribution(file, "frame p99", &stats->frame_p99, stats->rounds, true);
+}
+
+bool print_history_stats(const char *path, FILE *file)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < HISTORY_HEADER_SIZE)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The log is read through a memory map in one pass from front to back,
+	// so the pages are read ahead and no records have to be copied
+	size_t size = info.st_size;
+	const unsigned char *log = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (log == MAP_FAILED)
+	{
+		return false;
+	}
+	posix_madvise((void *)log, size, POSIX_MADV_SEQUENTIAL);
+
+	bool valid = memcmp(log, HISTORY_MAGIC, strlen(HISTORY_MAGIC)) == 0 &&
+				 log[strlen(HISTORY_MAGIC)] == HISTORY_VERSION;
+	HistoryStats *stats = calloc(1, sizeof(HistoryStats));
+	if (valid && stats != NULL)
+	{
+		// A record cut off at the end is left out
+		size_t count = (size - HISTORY_HEADER_SIZE) / sizeof(HistoryRecord);
+		const HistoryRecord *records = (const HistoryRecord *)(log + HISTORY_HEADER_SIZE);
+		for (size_t i = 0; i < count; i++)
+		{
+			add_record(stats, &records[i]);
+		}
+		print_stats(stats, file);
+		free(stats->months);
+	}
+
+	free(stats);
+	munmap((void *)log, size);
+	return valid && stats != NULL;
+}
@@ -0,0 +1,84 @@
+// Log of all rounds played in the terminal
+// Every finished round appends one record of a fixed size to the log, which
+// is never rewritten. A record cut off by a crash is ignored when reading and
+// removed when the log is opened for appending again.
+//
+// File format:
+//   "CSNH"                  magic (4 bytes)
+//   version                 1 byte
+//   reserved                3 zero bytes
+//   records                 `HistoryRecord`s in the byte order of the machine
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define HISTORY_MAGIC "CSNH"
+#define HISTORY_VERSION 1
+#define HISTORY_HEADER_SIZE 8
+#define HISTORY_SUFFIX ".history"
+
+// Bits of `HistoryRecord.flags`
+#define HISTORY_OPEN_BOUNDS 1
+#define HISTORY_WALLS 2
+#define HISTORY_AUTOPILOT 4
+#define HISTORY_BOT 8
+
+typedef enum RoundEnd
+{
+	END_GAME_OVER,
+	END_BOARD_FULL,
+	END_RESTART,
+	// The game was quit during the round
+	END_QUIT
+} RoundEnd;
+
+// A finished round, 64 bytes without padding
+typedef struct HistoryRecord
+{
+	// Time the round ended at (in seconds since the epoch)
+	int64_t timestamp;
+	int64_t score;
+	// Time (in ns) the round took, without pauses
+	int64_t duration;
+	int64_t ticks;
+	// Median and 99th percentile of the time (in ns) it took to render a frame
+	int64_t frame_p50;
+	int64_t frame_p99;
+	int32_t length;
+	int32_t board_width;
+	int32_t board_height;
+	// HISTORY_* bits of the rules and of who played
+	uint8_t flags;
+	uint8_t wall_pattern;
+	// `RoundEnd`
+	uint8_t end;
+	uint8_t reserved;
+} HistoryRecord;
+
+typedef struct History
+{
+	// File descriptor of the log opened for appending (-1 if not open)
+	int fd;
+} History;
+
+// Opens the log at `path` for appending, creating it if needed
+// Returns `false` on error, `true` otherwise
+bool open_history(History *history, const char *path);
+
+// Appends a record to an open log
+// Returns `false` on error, `true` otherwise
+bool append_history(History *history, const HistoryRecord *record);
+
+void close_history(History *history);
+
+// Prints the rounds, the best round of every configuration, the rounds of
+// every month and the distributions of score, length, duration and frame
+// times of the log at `path`, reading it in one pass
+// Returns `false` if the log can't be read, `true` otherwise
+bool print_history_stats(const char *path, FILE *file);
+
+#endif
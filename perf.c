@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "perf.h"
+
+#define NANOSECS_IN_MICROSEC 1000
+#define HISTOGRAM_WIDTH 40
+
+void init_perf_stats(PerfStats *stats)
+{
+	memset(stats, 0, sizeof(PerfStats));
+}
+
+// Bucket 0 holds samples below 1us, bucket `i` samples in [2^(i-1), 2^i) us
+int bucket_of(long long nanos)
+{
+	long long micros = nanos / NANOSECS_IN_MICROSEC;
+	int bucket = 0;
+	while (micros > 0 && bucket < PERF_BUCKETS - 1)
+	{
+		micros >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+void record_phase(PerfStats *stats, PerfPhase phase, long long nanos)
+{
+	PhaseStats *p = &stats->phases[phase];
+
+	p->recent[p->recent_next] = nanos;
+	p->recent_next = (p->recent_next + 1) % PERF_WINDOW;
+	if (p->recent_count < PERF_WINDOW)
+		p->recent_count++;
+
+	p->histogram[bucket_of(nanos)]++;
+	if (p->count == 0 || nanos < p->min)
+		p->min = nanos;
+	if (nanos > p->max)
+		p->max = nanos;
+	p->count++;
+	p->total += nanos;
+}
+
+void record_frame(PerfStats *stats, long long nanos, long long target)
+{
+	stats->frames++;
+	if (nanos > target)
+		stats->overruns++;
+}
+
+int compare_nanos(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+	return (x > y) - (x < y);
+}
+
+PhaseSummary summarize_phase(PhaseStats *phase)
+{
+	PhaseSummary summary = {0, 0, 0};
+	if (phase->recent_count == 0)
+		return summary;
+
+	long long sorted[PERF_WINDOW], total = 0;
+	memcpy(sorted, phase->recent, phase->recent_count * sizeof(long long));
+	qsort(sorted, phase->recent_count, sizeof(long long), compare_nanos);
+	for (int i = 0; i < phase->recent_count; i++)
+		total += sorted[i];
+
+	summary.min = sorted[0];
+	summary.avg = total / phase->recent_count;
+	summary.p99 = sorted[(phase->recent_count * 99) / 100];
+	return summary;
+}
+
+// Bucket of a log histogram holding `value`
+int log_bucket_of(long long value)
+{
+	if (value < LOG_SUB_BUCKETS)
+		return value;
+
+	// Position of the highest set bit, the next bits select the sub-bucket
+	int high = 0;
+	while ((value >> high) > 1)
+		high++;
+	int shift = high - LOG_SUB_BITS;
+	return (shift + 1) * LOG_SUB_BUCKETS + ((value >> shift) & (LOG_SUB_BUCKETS - 1));
+}
+
+// Lowest value of a bucket of a log histogram
+long long log_bucket_start(int bucket)
+{
+	if (bucket < LOG_SUB_BUCKETS)
+		return bucket;
+
+	int shift = bucket / LOG_SUB_BUCKETS - 1;
+	return (long long)(LOG_SUB_BUCKETS + bucket % LOG_SUB_BUCKETS) << shift;
+}
+
+void add_log_sample(LogHistogram *histogram, long long value)
+{
+	histogram->buckets[log_bucket_of(value > 0 ? value : 0)]++;
+	histogram->count++;
+}
+
+long long log_percentile(const LogHistogram *histogram, int percent)
+{
+	if (histogram->count == 0)
+		return 0;
+
+	// Rank of the value, counted from 1
+	long long rank = (histogram->count * percent + 99) / 100;
+	rank = (rank > 0) ? rank : 1;
+	for (int i = 0; i < LOG_BUCKETS; i++)
+	{
+		rank -= histogram->buckets[i];
+		if (rank <= 0)
+		{
+			// The end of the last bucket doesn't fit into a long long
+			long long start = log_bucket_start(i);
+			return (i + 1 < LOG_BUCKETS) ? start + (log_bucket_start(i + 1) - start) / 2 : start;
+		}
+	}
+	return 0;
+}
+
+const char *phase_name(PerfPhase phase)
+{
+	switch (phase)
+	{
+	case PHASE_INPUT:
+		return "input";
+	case PHASE_UPDATE:
+		return "update";
+	case PHASE_PAINT:
+		return "paint";
+	case PHASE_STATUS:
+		return "status";
+	case PHASE_REFRESH:
+		return "refresh";
+	case PHASE_WAIT:
+		return "wait";
+	default:
+		return "?";
+	}
+}
+
+void format_duration(char *buffer, size_t bufsize, long long nanos)
+{
+	// One decimal place below 10 units, none above
+	const char *units = "num";
+	double value = nanos;
+	int unit = 0;
+	while (value >= 1000 && unit < 3)
+	{
+		value /= 1000;
+		unit++;
+	}
+
+	if (unit == 0)
+		snprintf(buffer, bufsize, "%dn", (int)nanos);
+	else if (unit == 3)
+		snprintf(buffer, bufsize, "%.1fs", value);
+	else
+		snprintf(buffer, bufsize, value < 10 ? "%.1f%c" : "%.0f%c", value, units[unit]);
+}
+
+void print_perf_histogram(PerfStats *stats, FILE *file)
+{
+	char min_buf[16], avg_buf[16], max_buf[16];
+
+	fprintf(file, "Frame timings: %lld frames, %lld over the target frame time\n",
+			stats->frames, stats->overruns);
+
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		PhaseStats *p = &stats->phases[phase];
+		if (p->count == 0)
+			continue;
+
+		format_duration(min_buf, sizeof(min_buf), p->min);
+		format_duration(avg_buf, sizeof(avg_buf), p->total / p->count);
+		format_duration(max_buf, sizeof(max_buf), p->max);
+		fprintf(file, "\n%s: %lld samples, min %s, avg %s, max %s\n",
+				phase_name(phase), p->count, min_buf, avg_buf, max_buf);
+
+		// Only print the buckets from the first to the last one used
+		long long most = 0;
+		int first = PERF_BUCKETS, last = 0;
+		for (int i = 0; i < PERF_BUCKETS; i++)
+		{
+			if (p->histogram[i] == 0)
+				continue;
+			first = i < first ? i : first;
+			last = i;
+			most = p->histogram[i] > most ? p->histogram[i] : most;
+		}
+
+		for (int i = first; i <= last; i++)
+		{
+			char range[48];
+			if (i == 0)
+				snprintf(range, sizeof(range), "< 1us");
+			else if (i == PERF_BUCKETS - 1)
+				snprintf(range, sizeof(range), ">= %lldus", 1LL << (i - 1));
+			else
+				snprintf(range, sizeof(range), "%lld-%lldus", 1LL << (i - 1), 1LL << i);
+
+			int width = (int)(p->histogram[i] * HISTOGRAM_WIDTH / most);
+			fprintf(file, "  %16s %10lld %6.2f%% ", range, p->histogram[i], 100.0 * p->histogram[i] / p->count);
+			for (int j = 0; j < width; j++)
+				fputc('#', file);
+			fputc('\n', file);
+		}
+	}
+}
@@ -0,0 +1,109 @@
+// Timing statistics for the phases of the game loop
+// Every phase keeps the most recent samples for rolling statistics and a
+// histogram over all samples of the session.
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdio.h>
+
+// Amount of recent samples the rolling statistics are computed from
+#define PERF_WINDOW 256
+// Buckets of the histograms: below 1 microsecond, then one per power of two
+#define PERF_BUCKETS 24
+// Buckets per power of two of log histograms (a power of two), enough
+// buckets for all values of a long long
+#define LOG_SUB_BUCKETS 16
+#define LOG_SUB_BITS 4
+#define LOG_BUCKETS ((64 - LOG_SUB_BITS) * LOG_SUB_BUCKETS)
+
+typedef enum PerfPhase
+{
+	// Reading keys into the input queue
+	PHASE_INPUT,
+	// Advancing the round by one step
+	PHASE_UPDATE,
+	// Painting the snake and the food
+	PHASE_PAINT,
+	// Updating the status window
+	PHASE_STATUS,
+	// Writing the windows to the terminal
+	PHASE_REFRESH,
+	// Sleeping until the next key, step or frame
+	PHASE_WAIT,
+	// Amount of phases
+	PHASE_COUNT
+} PerfPhase;
+
+typedef struct PhaseStats
+{
+	// Most recent samples (in ns) as a ring buffer
+	long long recent[PERF_WINDOW];
+	// Amount of valid entries in `recent`
+	int recent_count;
+	// Index the next sample is written to
+	int recent_next;
+	// Amount of samples per bucket
+	long long histogram[PERF_BUCKETS];
+	// Statistics over all samples
+	long long count;
+	long long total;
+	long long min;
+	long long max;
+} PhaseStats;
+
+typedef struct PerfStats
+{
+	PhaseStats phases[PHASE_COUNT];
+	// Amount of rendered frames
+	long long frames;
+	// Amount of frames that took longer than the target frame time
+	long long overruns;
+} PerfStats;
+
+// Counts of non-negative values in buckets that grow with the values, so
+// percentiles of any amount of values can be taken from a fixed amount of
+// memory. Values below LOG_SUB_BUCKETS have buckets of their own, larger ones
+// share a bucket with values less than 1 / LOG_SUB_BUCKETS apart.
+typedef struct LogHistogram
+{
+	long long buckets[LOG_BUCKETS];
+	long long count;
+} LogHistogram;
+
+typedef struct PhaseSummary
+{
+	long long min;
+	long long avg;
+	long long p99;
+} PhaseSummary;
+
+void init_perf_stats(PerfStats *stats);
+
+// Adds a sample of `nanos` nanoseconds to a phase
+void record_phase(PerfStats *stats, PerfPhase phase, long long nanos);
+
+// Counts a rendered frame that kept the loop busy for `nanos` nanoseconds
+void record_frame(PerfStats *stats, long long nanos, long long target);
+
+// Computes min, average and 99th percentile over the recent samples of a phase
+PhaseSummary summarize_phase(PhaseStats *phase);
+
+// Adds a value of at least 0 to a log histogram
+void add_log_sample(LogHistogram *histogram, long long value);
+
+// Estimates the value that `percent` percent of the values of a log histogram
+// are below, from the middle of the bucket holding it
+// Returns 0 if the histogram is empty.
+long long log_percentile(const LogHistogram *histogram, int percent);
+
+// Short name of a phase for display
+const char *phase_name(PerfPhase phase);
+
+// Formats a duration with a unit into a few characters (e.g. "3.4u", "123m")
+void format_duration(char *buffer, size_t bufsize, long long nanos);
+
+// Prints the histograms of all phases
+void print_perf_histogram(PerfStats *stats, FILE *file);
+
+#endif
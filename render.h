@@ -0,0 +1,132 @@
+// Output of a round, independent of where it goes
+// The frontend draws the part of the board shown on the screen, the status
+// bar and messages through a `Renderer`, whose backend decides how they are
+// shown. Drawing only changes what the next `present` puts on the screen.
+//
+// Backends:
+//   curses    draws to the terminal through ncurses (which must be initialized)
+//   ansi      writes escape sequences for the cells that changed on its own,
+//             ncurses is only used for input and in between rounds
+//   null      discards everything, so rounds can be timed without any output
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+
+#include "engine.h"
+
+// Rows of the screen taken by the status bar below the game area
+#define STATUS_ROWS 4
+
+// What a cell of the game area shows
+typedef enum Glyph
+{
+	GLYPH_EMPTY,
+	GLYPH_WALL,
+	GLYPH_FOOD,
+	GLYPH_SUPERFOOD,
+	GLYPH_HEAD,
+	// Parts of the body, named after the line they show
+	GLYPH_BODY_HORIZONTAL,
+	GLYPH_BODY_VERTICAL,
+	GLYPH_BODY_UPPER_LEFT,
+	GLYPH_BODY_UPPER_RIGHT,
+	GLYPH_BODY_LOWER_LEFT,
+	GLYPH_BODY_LOWER_RIGHT
+} Glyph;
+
+// Fields of the status bar
+typedef enum StatusField
+{
+	STATUS_BONUS,
+	STATUS_SCORE,
+	// Time and highscore are left out if the status bar is too narrow
+	STATUS_TIME,
+	STATUS_HIGHSCORE,
+	STATUS_FIELD_COUNT
+} StatusField;
+
+// Row and column a field of a status bar with `width` columns is centered
+// around
+// Returns `false` if the status bar is too narrow for the field, `true` otherwise
+static inline bool status_field_layout(StatusField field, int width, int *row, int *center)
+{
+	// Bonus and score are centered in the left third if there is space for
+	// time and highscore, otherwise they are centered in the status bar
+	*row = (field == STATUS_BONUS || field == STATUS_TIME) ? 1 : 2;
+	*center = (width > 50) ? (width / 3) : (width / 2);
+	if (field == STATUS_TIME || field == STATUS_HIGHSCORE)
+	{
+		*center = 2 * width / 3;
+		return width > 50;
+	}
+	return true;
+}
+
+// Color of a message
+typedef enum MessageTone
+{
+	TONE_NEUTRAL,
+	TONE_GOOD,
+	TONE_BAD
+} MessageTone;
+
+typedef struct Renderer Renderer;
+
+typedef struct RendererOps
+{
+	// Size of the game area on a screen without a round
+	Coord (*area_size)(Renderer *renderer);
+	// Prepares the screen for a round on a board of `board_size`
+	// Returns the amount of cells the game area shows along each side.
+	Coord (*begin_round)(Renderer *renderer, Coord board_size);
+	// Clears the game area
+	void (*clear_area)(Renderer *renderer);
+	// Draws `glyph` at `position` of the game area
+	void (*draw_cell)(Renderer *renderer, Coord position, Glyph glyph);
+	// Draws `length` walls from `position` of the game area to the right, or
+	// down if `vertical`
+	void (*draw_wall_run)(Renderer *renderer, Coord position, int length, bool vertical);
+	// Clears the status bar, so no field or text is shown
+	void (*clear_status)(Renderer *renderer);
+	// Shows `text` in a field of the status bar in place of its last text
+	void (*status_field)(Renderer *renderer, StatusField field, const char *text);
+	// Shows up to `width` characters of `text` in row `row` of the status bar
+	// from column `column` on (row 0 is the top border)
+	void (*status_text)(Renderer *renderer, int row, int column, const char *text, int width);
+	// Shows `text` in place of the status bar and puts it on the screen
+	// right away
+	void (*show_message)(Renderer *renderer, const char *text, MessageTone tone);
+	// Puts everything drawn since the last call on the screen
+	void (*present)(Renderer *renderer);
+	// Ends the round started with `begin_round`
+	void (*end_round)(Renderer *renderer);
+} RendererOps;
+
+struct Renderer
+{
+	const RendererOps *ops;
+	// Specifies whether the output goes to a terminal the user types into
+	bool interactive;
+	// Columns of the status bar (set by `begin_round`)
+	int status_width;
+	// Color pair the snake is drawn in (see `init_pair` in `main`)
+	int snake_color;
+	// Background of the color pairs without one of their own, -1 for the
+	// default color of the terminal (see `init_pair` in `main`)
+	int background;
+};
+
+// Returns the renderer drawing to the terminal through ncurses
+Renderer *curses_renderer(void);
+
+// Returns the renderer writing escape sequences to the terminal, which is
+// set up by ncurses
+Renderer *ansi_renderer(void);
+
+// Returns a renderer discarding everything drawn, as if it was drawn to a
+// terminal of `screen_size`
+Renderer *null_renderer(Coord screen_size);
+
+#endif
@@ -0,0 +1,521 @@
+// we are using write from POSIX
+// see here: https://www.gnu.org/software/libc/manual/html_node/Feature-Test-Macros.html#index-_005fPOSIX_005fC_005fSOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <ncurses.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "render.h"
+
+// Layout of the cells of the framebuffers: character, color pair and
+// attributes are packed into one word, so rows are compared as integers
+#define CELL_CHAR_MASK 0xffu
+#define CELL_PAIR_SHIFT 8
+#define CELL_PAIR_MASK (0xfu << CELL_PAIR_SHIFT)
+#define CELL_BOLD (1u << 12)
+// The character is taken from the DEC line drawing set (like ncurses' ACS)
+#define CELL_LINE (1u << 13)
+#define CELL_ATTR_MASK (CELL_PAIR_MASK | CELL_BOLD)
+
+// Empty cell in the default color pair of the screen (see `bkgd` in `main`)
+#define BLANK_CELL (' ' | (1u << CELL_PAIR_SHIFT))
+
+// Unchanged cells between two changed runs of a row are written again if
+// they take fewer bytes than the cursor movement over them
+#define MAX_BRIDGE 4
+
+// Bytes the sequences for one cell take at most: cursor movement,
+// attributes, character set and the character itself
+#define MAX_CELL_BYTES 32
+
+// Synchronized output: the terminal shows a frame only once it is complete
+#define BEGIN_FRAME "\x1b[?2026h"
+#define END_FRAME "\x1b[?2026l"
+// Leaves attributes and character set as ncurses expects them
+#define RESET_STATE "\x1b(B\x1b[0m"
+
+// Characters of the DEC line drawing set
+#define LINE_CKBOARD 'a'
+#define LINE_HLINE 'q'
+#define LINE_VLINE 'x'
+#define LINE_ULCORNER 'l'
+#define LINE_URCORNER 'k'
+#define LINE_LLCORNER 'm'
+#define LINE_LRCORNER 'j'
+
+typedef struct ShownText
+{
+	// Column the text starts at
+	int x;
+	// Length of the text (0 if nothing is shown)
+	int length;
+} ShownText;
+
+typedef struct AnsiRenderer
+{
+	Renderer base;
+	// Size of the screen and of the game area (which starts at the top left
+	// corner, the status bar starts in the row below it)
+	Coord screen;
+	Coord area;
+	int status_top;
+	// Cells drawn for the next frame and cells the terminal shows
+	uint32_t *back;
+	uint32_t *front;
+	int cell_count;
+	// Escape sequences of the frame being written
+	char *out;
+	size_t out_length;
+	size_t out_capacity;
+	// State of the terminal while the frame is written
+	int cursor_x;
+	int cursor_y;
+	uint32_t attributes;
+	bool line_set;
+	// Texts of the fields of the status bar
+	ShownText fields[STATUS_FIELD_COUNT];
+} AnsiRenderer;
+
+// Colors (as in SGR codes) of the color pairs set up in `main`, 9 is the
+// default color of the terminal. A background of 9 is replaced by the one
+// `main` chose for the pairs.
+static const struct
+{
+	unsigned char foreground;
+	unsigned char background;
+} pair_colors[] = {
+	{9, 9}, {7, 9}, {2, 9}, {1, 9}, {3, 9}, {4, 9}, {0, 2}, {0, 1}, {0, 3}, {0, 4}};
+
+static inline uint32_t make_cell(unsigned char ch, int pair, uint32_t flags)
+{
+	return ch | ((uint32_t)pair << CELL_PAIR_SHIFT) | flags;
+}
+
+// Finds the first cell from `start` on in which `back` and `front` are
+// equal (if `equal`) or differ (otherwise)
+// Returns the index of the cell or `end` if there is none.
+static inline int scan_row(const uint32_t *back, const uint32_t *front, int start, int end, bool equal)
+{
+	int x = start;
+#if defined(__AVX2__)
+	for (; x + 8 <= end; x += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *)(back + x));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(front + x));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b));
+		mask = equal ? mask : ~mask;
+		if (mask != 0)
+		{
+			return x + __builtin_ctz(mask) / 4;
+		}
+	}
+#elif defined(__SSE2__)
+	for (; x + 4 <= end; x += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(back + x));
+		__m128i b = _mm_loadu_si128((const __m128i *)(front + x));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi32(a, b));
+		mask = (equal ? mask : ~mask) & 0xffff;
+		if (mask != 0)
+		{
+			return x + __builtin_ctz(mask) / 4;
+		}
+	}
+#endif
+	while (x < end && (back[x] == front[x]) != equal)
+	{
+		x++;
+	}
+	return x;
+}
+
+static inline void append(AnsiRenderer *ansi, const char *bytes, size_t length)
+{
+	memcpy(ansi->out + ansi->out_length, bytes, length);
+	ansi->out_length += length;
+}
+
+// Moves the cursor of the terminal to `x`, `y` of the screen
+static void move_cursor(AnsiRenderer *ansi, int x, int y)
+{
+	if (x == ansi->cursor_x && y == ansi->cursor_y)
+	{
+		return;
+	}
+
+	char sequence[24];
+	int length = snprintf(sequence, sizeof(sequence), "\x1b[%d;%dH", y + 1, x + 1);
+	append(ansi, sequence, length);
+	ansi->cursor_x = x;
+	ansi->cursor_y = y;
+}
+
+// Writes `cell` at the cursor, switching attributes and character set if needed
+static void put_cell(AnsiRenderer *ansi, uint32_t cell)
+{
+	uint32_t attributes = cell & CELL_ATTR_MASK;
+	if (attributes != ansi->attributes)
+	{
+		int pair = (attributes & CELL_PAIR_MASK) >> CELL_PAIR_SHIFT;
+		int background = pair_colors[pair].background;
+		if (background == 9 && ansi->base.background >= 0)
+		{
+			background = ansi->base.background;
+		}
+		char sequence[24];
+		int length = snprintf(sequence, sizeof(sequence), "\x1b[0%s;3%d;4%dm", (attributes & CELL_BOLD) ? ";1" : "",
+							  pair_colors[pair].foreground, background);
+		append(ansi, sequence, length);
+		ansi->attributes = attributes;
+	}
+
+	bool line_set = (cell & CELL_LINE) != 0;
+	if (line_set != ansi->line_set)
+	{
+		append(ansi, line_set ? "\x1b(0" : "\x1b(B", 3);
+		ansi->line_set = line_set;
+	}
+
+	ansi->out[ansi->out_length++] = (char)(cell & CELL_CHAR_MASK);
+
+	// After the last column the terminal keeps the cursor there until the
+	// next character, so its position is not known
+	ansi->cursor_x++;
+	if (ansi->cursor_x >= ansi->screen.x)
+	{
+		ansi->cursor_x = -1;
+	}
+}
+
+// Writes the frame to the terminal
+static void flush_frame(AnsiRenderer *ansi)
+{
+	size_t done = 0;
+	while (done < ansi->out_length)
+	{
+		ssize_t result = write(STDOUT_FILENO, ansi->out + done, ansi->out_length - done);
+		if (result < 0 && errno != EINTR)
+		{
+			break;
+		}
+		done += (result > 0) ? result : 0;
+	}
+	ansi->out_length = 0;
+}
+
+static inline void put_back(AnsiRenderer *ansi, int x, int y, uint32_t cell)
+{
+	if (x >= 0 && x < ansi->screen.x && y >= 0 && y < ansi->screen.y)
+	{
+		ansi->back[y * ansi->screen.x + x] = cell;
+	}
+}
+
+// Writes `text` from column `x` of row `y` of the screen, up to `width` characters
+static void set_text(AnsiRenderer *ansi, int x, int y, const char *text, int width, uint32_t flags)
+{
+	for (int i = 0; i < width && text[i] != '\0'; i++)
+	{
+		put_back(ansi, x + i, y, make_cell(text[i], 1, flags));
+	}
+}
+
+// Fills the rows `top` to `bottom` (exclusive) of the screen with blanks
+static void clear_rows(AnsiRenderer *ansi, int top, int bottom, int width)
+{
+	for (int y = top; y < bottom; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			put_back(ansi, x, y, BLANK_CELL);
+		}
+	}
+}
+
+// Draws the border of the status bar in color pair `pair`
+static void draw_status_box(AnsiRenderer *ansi, int pair)
+{
+	int top = ansi->status_top, bottom = top + STATUS_ROWS - 1, right = ansi->screen.x - 1;
+	uint32_t flags = CELL_BOLD | CELL_LINE;
+	for (int x = 1; x < right; x++)
+	{
+		put_back(ansi, x, top, make_cell(LINE_HLINE, pair, flags));
+		put_back(ansi, x, bottom, make_cell(LINE_HLINE, pair, flags));
+	}
+	for (int y = top + 1; y < bottom; y++)
+	{
+		put_back(ansi, 0, y, make_cell(LINE_VLINE, pair, flags));
+		put_back(ansi, right, y, make_cell(LINE_VLINE, pair, flags));
+	}
+	put_back(ansi, 0, top, make_cell(LINE_ULCORNER, pair, flags));
+	put_back(ansi, right, top, make_cell(LINE_URCORNER, pair, flags));
+	put_back(ansi, 0, bottom, make_cell(LINE_LLCORNER, pair, flags));
+	put_back(ansi, right, bottom, make_cell(LINE_LRCORNER, pair, flags));
+}
+
+Coord ansi_area_size(Renderer *renderer)
+{
+	(void)renderer;
+	return coord(getmaxx(stdscr), getmaxy(stdscr) - STATUS_ROWS);
+}
+
+Coord ansi_begin_round(Renderer *renderer, Coord board_size)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+
+	// ncurses clears the screen, so the terminal shows blanks to start from
+	clear();
+	refresh();
+
+	// The game area shows as much of the board as fits into the terminal
+	Coord area = ansi_area_size(renderer);
+	ansi->screen = coord(getmaxx(stdscr), getmaxy(stdscr));
+	ansi->area = coord((board_size.x < area.x) ? board_size.x : area.x, (board_size.y < area.y) ? board_size.y : area.y);
+	ansi->status_top = ansi->area.y;
+	renderer->status_width = ansi->screen.x;
+
+	// Every cell is written at most once per frame, so the buffer of the
+	// escape sequences never has to grow during a round
+	int cell_count = ansi->screen.x * ansi->screen.y;
+	if (cell_count != ansi->cell_count)
+	{
+		free(ansi->back);
+		free(ansi->front);
+		free(ansi->out);
+		ansi->back = malloc(cell_count * sizeof(uint32_t));
+		ansi->front = malloc(cell_count * sizeof(uint32_t));
+		ansi->out_capacity = (size_t)cell_count * MAX_CELL_BYTES + 64;
+		ansi->out = malloc(ansi->out_capacity);
+		if (ansi->back == NULL || ansi->front == NULL || ansi->out == NULL)
+		{
+			abort();
+		}
+		ansi->cell_count = cell_count;
+	}
+	for (int i = 0; i < cell_count; i++)
+	{
+		ansi->back[i] = BLANK_CELL;
+		ansi->front[i] = BLANK_CELL;
+	}
+	ansi->out_length = 0;
+	for (int i = 0; i < STATUS_FIELD_COUNT; i++)
+	{
+		ansi->fields[i].length = 0;
+	}
+
+	return ansi->area;
+}
+
+void ansi_clear_area(Renderer *renderer)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	clear_rows(ansi, 0, ansi->area.y, ansi->area.x);
+}
+
+void ansi_draw_cell(Renderer *renderer, Coord position, Glyph glyph)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	int body_pair = renderer->snake_color;
+	uint32_t cell;
+	switch (glyph)
+	{
+	case GLYPH_WALL:
+		cell = make_cell(LINE_CKBOARD, 5, CELL_BOLD | CELL_LINE);
+		break;
+	case GLYPH_FOOD:
+		cell = make_cell('0', 3, CELL_BOLD);
+		break;
+	case GLYPH_SUPERFOOD:
+		cell = make_cell('0', 4, CELL_BOLD);
+		break;
+	case GLYPH_HEAD:
+		cell = make_cell('X', body_pair, CELL_BOLD);
+		break;
+	case GLYPH_BODY_HORIZONTAL:
+		cell = make_cell(LINE_HLINE, body_pair, CELL_BOLD | CELL_LINE);
+		break;
+	case GLYPH_BODY_VERTICAL:
+		cell = make_cell(LINE_VLINE, body_pair, CELL_BOLD | CELL_LINE);
+		break;
+	case GLYPH_BODY_UPPER_LEFT:
+		cell = make_cell(LINE_ULCORNER, body_pair, CELL_BOLD | CELL_LINE);
+		break;
+	case GLYPH_BODY_UPPER_RIGHT:
+		cell = make_cell(LINE_URCORNER, body_pair, CELL_BOLD | CELL_LINE);
+		break;
+	case GLYPH_BODY_LOWER_LEFT:
+		cell = make_cell(LINE_LLCORNER, body_pair, CELL_BOLD | CELL_LINE);
+		break;
+	case GLYPH_BODY_LOWER_RIGHT:
+		cell = make_cell(LINE_LRCORNER, body_pair, CELL_BOLD | CELL_LINE);
+		break;
+	default:
+		cell = BLANK_CELL;
+		break;
+	}
+	if (position.x < ansi->area.x && position.y < ansi->area.y)
+	{
+		put_back(ansi, position.x, position.y, cell);
+	}
+}
+
+void ansi_draw_wall_run(Renderer *renderer, Coord position, int length, bool vertical)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	uint32_t wall = make_cell(LINE_CKBOARD, 5, CELL_BOLD | CELL_LINE);
+	for (int i = 0; i < length; i++)
+	{
+		Coord cell = vertical ? coord(position.x, position.y + i) : coord(position.x + i, position.y);
+		if (cell.x < ansi->area.x && cell.y < ansi->area.y)
+		{
+			put_back(ansi, cell.x, cell.y, wall);
+		}
+	}
+}
+
+void ansi_clear_status(Renderer *renderer)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	clear_rows(ansi, ansi->status_top + 1, ansi->status_top + STATUS_ROWS - 1, ansi->screen.x);
+	draw_status_box(ansi, 1);
+	for (int i = 0; i < STATUS_FIELD_COUNT; i++)
+	{
+		ansi->fields[i].length = 0;
+	}
+}
+
+void ansi_status_field(Renderer *renderer, StatusField field, const char *text)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	int row, center;
+	if (!status_field_layout(field, ansi->screen.x, &row, &center))
+	{
+		return;
+	}
+
+	// Blank the last text, the diff of the frame skips cells that don't change
+	ShownText *shown = &ansi->fields[field];
+	for (int x = shown->x; x < shown->x + shown->length; x++)
+	{
+		put_back(ansi, x, ansi->status_top + row, BLANK_CELL);
+	}
+
+	int length = strlen(text);
+	shown->x = center - length / 2;
+	shown->length = length;
+	set_text(ansi, shown->x, ansi->status_top + row, text, length, CELL_BOLD);
+}
+
+void ansi_status_text(Renderer *renderer, int row, int column, const char *text, int width)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	set_text(ansi, column, ansi->status_top + row, text, width, CELL_BOLD);
+}
+
+void ansi_present(Renderer *renderer)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	int width = ansi->screen.x;
+
+	append(ansi, BEGIN_FRAME, strlen(BEGIN_FRAME));
+	ansi->cursor_x = -1;
+	ansi->cursor_y = -1;
+	ansi->attributes = 0;
+	ansi->line_set = false;
+
+	for (int y = 0; y < ansi->screen.y; y++)
+	{
+		uint32_t *back = ansi->back + y * width;
+		uint32_t *front = ansi->front + y * width;
+		int x = scan_row(back, front, 0, width, false);
+		while (x < width)
+		{
+			// Extend the run of changed cells over short gaps
+			int end = scan_row(back, front, x, width, true);
+			int next = scan_row(back, front, end, width, false);
+			while (next < width && next - end <= MAX_BRIDGE)
+			{
+				end = scan_row(back, front, next, width, true);
+				next = scan_row(back, front, end, width, false);
+			}
+
+			move_cursor(ansi, x, y);
+			for (int i = x; i < end; i++)
+			{
+				put_cell(ansi, back[i]);
+				front[i] = back[i];
+			}
+			x = next;
+		}
+	}
+
+	append(ansi, RESET_STATE, strlen(RESET_STATE));
+	append(ansi, END_FRAME, strlen(END_FRAME));
+	flush_frame(ansi);
+}
+
+void ansi_show_message(Renderer *renderer, const char *text, MessageTone tone)
+{
+	AnsiRenderer *ansi = (AnsiRenderer *)renderer;
+	static const int tone_pairs[] = {4, 2, 3};
+	int pair = tone_pairs[tone];
+
+	// Clear the status bar and redraw the box
+	clear_rows(ansi, ansi->status_top, ansi->status_top + STATUS_ROWS, ansi->screen.x);
+	draw_status_box(ansi, pair);
+
+	// Print the message
+	int length = strlen(text);
+	int x = ansi->screen.x / 2 - length / 2;
+	for (int i = 0; i < length; i++)
+	{
+		put_back(ansi, x + i, ansi->status_top + 1, make_cell(text[i], pair, CELL_BOLD));
+	}
+	ansi_present(renderer);
+
+	// The fields have to be printed again
+	ansi_clear_status(renderer);
+}
+
+void ansi_end_round(Renderer *renderer)
+{
+	(void)renderer;
+
+	// ncurses doesn't know what was written, so it redraws everything
+	clear();
+	refresh();
+}
+
+static const RendererOps ansi_ops = {
+	.area_size = ansi_area_size,
+	.begin_round = ansi_begin_round,
+	.clear_area = ansi_clear_area,
+	.draw_cell = ansi_draw_cell,
+	.draw_wall_run = ansi_draw_wall_run,
+	.clear_status = ansi_clear_status,
+	.status_field = ansi_status_field,
+	.status_text = ansi_status_text,
+	.show_message = ansi_show_message,
+	.present = ansi_present,
+	.end_round = ansi_end_round,
+};
+
+Renderer *ansi_renderer(void)
+{
+	static AnsiRenderer renderer;
+	renderer.base.ops = &ansi_ops;
+	renderer.base.interactive = true;
+	renderer.base.status_width = 0;
+	renderer.base.snake_color = 1;
+	renderer.base.background = -1;
+	return &renderer.base;
+}
@@ -0,0 +1,259 @@
+#include <ncurses.h>
+#include <string.h>
+
+#include "render.h"
+
+// Status fields are only as wide as the texts shown in them
+#define STATUS_FIELD_SIZE 50
+
+typedef struct ShownField
+{
+	// Text currently shown in the field (empty if nothing is shown)
+	char text[STATUS_FIELD_SIZE];
+	// Column the text starts at
+	int x;
+} ShownField;
+
+typedef struct CursesRenderer
+{
+	Renderer base;
+	WINDOW *game_win;
+	WINDOW *status_win;
+	// What the fields of the status window show
+	ShownField fields[STATUS_FIELD_COUNT];
+} CursesRenderer;
+
+static inline size_t half_len(const char string[])
+{
+	return strlen(string) / 2;
+}
+
+Coord curses_area_size(Renderer *renderer)
+{
+	(void)renderer;
+	return coord(getmaxx(stdscr), getmaxy(stdscr) - STATUS_ROWS);
+}
+
+Coord curses_begin_round(Renderer *renderer, Coord board_size)
+{
+	CursesRenderer *curses = (CursesRenderer *)renderer;
+
+	// Clear screen
+	clear();
+	refresh();
+
+	// The game window shows as much of the board as fits into the terminal
+	Coord area = curses_area_size(renderer);
+	int game_max_x = (board_size.x < area.x) ? board_size.x : area.x;
+	int game_max_y = (board_size.y < area.y) ? board_size.y : area.y;
+
+	// Create subwindows
+	curses->game_win = subwin(stdscr, game_max_y, game_max_x, 0, 0);
+	curses->status_win = subwin(stdscr, STATUS_ROWS, area.x, game_max_y, 0);
+	renderer->status_width = area.x;
+	return coord(getmaxx(curses->game_win), getmaxy(curses->game_win));
+}
+
+void curses_clear_area(Renderer *renderer)
+{
+	werase(((CursesRenderer *)renderer)->game_win);
+}
+
+void curses_draw_cell(Renderer *renderer, Coord position, Glyph glyph)
+{
+	chtype body_color = COLOR_PAIR(renderer->snake_color) | A_BOLD;
+	chtype ch;
+	switch (glyph)
+	{
+	case GLYPH_WALL:
+		ch = ACS_CKBOARD | COLOR_PAIR(5) | A_BOLD;
+		break;
+	case GLYPH_FOOD:
+		ch = '0' | COLOR_PAIR(3) | A_BOLD;
+		break;
+	case GLYPH_SUPERFOOD:
+		ch = '0' | COLOR_PAIR(4) | A_BOLD;
+		break;
+	case GLYPH_HEAD:
+		ch = 'X' | body_color;
+		break;
+	case GLYPH_BODY_HORIZONTAL:
+		ch = ACS_HLINE | body_color;
+		break;
+	case GLYPH_BODY_VERTICAL:
+		ch = ACS_VLINE | body_color;
+		break;
+	case GLYPH_BODY_UPPER_LEFT:
+		ch = ACS_ULCORNER | body_color;
+		break;
+	case GLYPH_BODY_UPPER_RIGHT:
+		ch = ACS_URCORNER | body_color;
+		break;
+	case GLYPH_BODY_LOWER_LEFT:
+		ch = ACS_LLCORNER | body_color;
+		break;
+	case GLYPH_BODY_LOWER_RIGHT:
+		ch = ACS_LRCORNER | body_color;
+		break;
+	default:
+		ch = ' ' | A_NORMAL;
+		break;
+	}
+	mvwaddch(((CursesRenderer *)renderer)->game_win, position.y, position.x, ch);
+}
+
+void curses_draw_wall_run(Renderer *renderer, Coord position, int length, bool vertical)
+{
+	WINDOW *game_win = ((CursesRenderer *)renderer)->game_win;
+	chtype wall_char = ACS_CKBOARD | COLOR_PAIR(5) | A_BOLD;
+	if (vertical)
+	{
+		mvwvline(game_win, position.y, position.x, wall_char, length);
+	}
+	else
+	{
+		mvwhline(game_win, position.y, position.x, wall_char, length);
+	}
+}
+
+void curses_clear_status(Renderer *renderer)
+{
+	CursesRenderer *curses = (CursesRenderer *)renderer;
+
+	// Deleting rows and redrawing the box
+	wattrset(curses->status_win, A_BOLD);
+	wmove(curses->status_win, 1, 0);
+	wclrtoeol(curses->status_win);
+	wmove(curses->status_win, 2, 0);
+	wclrtoeol(curses->status_win);
+	box(curses->status_win, 0, 0);
+
+	// Nothing is shown in the fields now
+	for (int i = 0; i < STATUS_FIELD_COUNT; i++)
+	{
+		curses->fields[i].text[0] = '\0';
+	}
+}
+
+// Shows `text` centered around column `center` in row `y` of the status
+// window, only touching the cells that differ from what the field shows
+void update_status_field(WINDOW *status_win, ShownField *field, int y, int center, const char *text)
+{
+	int x = center - half_len(text);
+	int length = strlen(text);
+	int old_length = strlen(field->text);
+	if (x == field->x && strcmp(text, field->text) == 0)
+	{
+		return;
+	}
+
+	// Walk over all cells covered by the old or the new text
+	int start = x, end = x + length;
+	if (old_length > 0)
+	{
+		start = field->x < start ? field->x : start;
+		end = field->x + old_length > end ? field->x + old_length : end;
+	}
+	for (int column = start; column < end; column++)
+	{
+		char old_char = (column >= field->x && column < field->x + old_length) ? field->text[column - field->x] : ' ';
+		char new_char = (column >= x && column < x + length) ? text[column - x] : ' ';
+		if (old_char != new_char)
+		{
+			mvwaddch(status_win, y, column, new_char);
+		}
+	}
+
+	strncpy(field->text, text, STATUS_FIELD_SIZE - 1);
+	field->text[STATUS_FIELD_SIZE - 1] = '\0';
+	field->x = x;
+}
+
+void curses_status_field(Renderer *renderer, StatusField field, const char *text)
+{
+	CursesRenderer *curses = (CursesRenderer *)renderer;
+	int row, center;
+	if (!status_field_layout(field, getmaxx(curses->status_win), &row, &center))
+	{
+		return;
+	}
+
+	wattrset(curses->status_win, A_BOLD);
+	update_status_field(curses->status_win, &curses->fields[field], row, center, text);
+}
+
+void curses_status_text(Renderer *renderer, int row, int column, const char *text, int width)
+{
+	WINDOW *status_win = ((CursesRenderer *)renderer)->status_win;
+	wattrset(status_win, A_BOLD);
+	mvwaddnstr(status_win, row, column, text, width);
+}
+
+void curses_show_message(Renderer *renderer, const char *text, MessageTone tone)
+{
+	WINDOW *status_win = ((CursesRenderer *)renderer)->status_win;
+	static const short tone_colors[] = {4, 2, 3};
+
+	// Clear status window and redraw the box
+	wclear(status_win);
+	wattrset(status_win, COLOR_PAIR(tone_colors[tone]) | A_BOLD);
+	box(status_win, 0, 0);
+
+	// Print the message
+	int x = (getmaxx(status_win) / 2) - half_len(text);
+	mvwaddstr(status_win, 1, x, text);
+	wrefresh(status_win);
+
+	// The fields have to be printed again
+	curses_clear_status(renderer);
+}
+
+void curses_present(Renderer *renderer)
+{
+	CursesRenderer *curses = (CursesRenderer *)renderer;
+
+	// Write both windows to the terminal at once
+	wnoutrefresh(curses->game_win);
+	wnoutrefresh(curses->status_win);
+	doupdate();
+}
+
+void curses_end_round(Renderer *renderer)
+{
+	CursesRenderer *curses = (CursesRenderer *)renderer;
+
+	// Delete windows
+	delwin(curses->game_win);
+	delwin(curses->status_win);
+	curses->game_win = NULL;
+	curses->status_win = NULL;
+
+	// Delete the screen content
+	clear();
+	refresh();
+}
+
+static const RendererOps curses_ops = {
+	.area_size = curses_area_size,
+	.begin_round = curses_begin_round,
+	.clear_area = curses_clear_area,
+	.draw_cell = curses_draw_cell,
+	.draw_wall_run = curses_draw_wall_run,
+	.clear_status = curses_clear_status,
+	.status_field = curses_status_field,
+	.status_text = curses_status_text,
+	.show_message = curses_show_message,
+	.present = curses_present,
+	.end_round = curses_end_round,
+};
+
+Renderer *curses_renderer(void)
+{
+	static CursesRenderer renderer;
+	renderer.base.ops = &curses_ops;
+	renderer.base.interactive = true;
+	renderer.base.status_width = 0;
+	renderer.base.snake_color = 1;
+	renderer.base.background = -1;
+	return &renderer.base;
+}
@@ -0,0 +1,92 @@
+#include "render.h"
+
+typedef struct NullRenderer
+{
+	Renderer base;
+	// Size of the terminal the renderer pretends to draw to
+	Coord screen_size;
+} NullRenderer;
+
+Coord null_area_size(Renderer *renderer)
+{
+	NullRenderer *null = (NullRenderer *)renderer;
+	return coord(null->screen_size.x, null->screen_size.y - STATUS_ROWS);
+}
+
+Coord null_begin_round(Renderer *renderer, Coord board_size)
+{
+	// The game area shows as much of the board as fits onto the screen, so
+	// the frontend draws as many cells as it would for a terminal
+	Coord area = null_area_size(renderer);
+	renderer->status_width = ((NullRenderer *)renderer)->screen_size.x;
+	return coord((board_size.x < area.x) ? board_size.x : area.x, (board_size.y < area.y) ? board_size.y : area.y);
+}
+
+void null_discard(Renderer *renderer)
+{
+	(void)renderer;
+}
+
+void null_draw_cell(Renderer *renderer, Coord position, Glyph glyph)
+{
+	(void)renderer;
+	(void)position;
+	(void)glyph;
+}
+
+void null_draw_wall_run(Renderer *renderer, Coord position, int length, bool vertical)
+{
+	(void)renderer;
+	(void)position;
+	(void)length;
+	(void)vertical;
+}
+
+void null_status_field(Renderer *renderer, StatusField field, const char *text)
+{
+	(void)renderer;
+	(void)field;
+	(void)text;
+}
+
+void null_status_text(Renderer *renderer, int row, int column, const char *text, int width)
+{
+	(void)renderer;
+	(void)row;
+	(void)column;
+	(void)text;
+	(void)width;
+}
+
+void null_show_message(Renderer *renderer, const char *text, MessageTone tone)
+{
+	(void)renderer;
+	(void)text;
+	(void)tone;
+}
+
+static const RendererOps null_ops = {
+	.area_size = null_area_size,
+	.begin_round = null_begin_round,
+	.clear_area = null_discard,
+	.draw_cell = null_draw_cell,
+	.draw_wall_run = null_draw_wall_run,
+	.clear_status = null_discard,
+	.status_field = null_status_field,
+	.status_text = null_status_text,
+	.show_message = null_show_message,
+	.present = null_discard,
+	.end_round = null_discard,
+};
+
+Renderer *null_renderer(Coord screen_size)
+{
+	static NullRenderer renderer;
+	renderer.base.ops = &null_ops;
+	renderer.base.interactive = false;
+	renderer.base.status_width = screen_size.x;
+	renderer.base.snake_color = 0;
+	renderer.base.background = -1;
+	renderer.screen_size = screen_size;
+	return &renderer.base;
+}
@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+
+#define REPLAY_MAGIC "CSNR"
+#define REPLAY_VERSION 2 // Version 2: food only spawns on cells the head can reach
+#define REPLAY_EVENT_BITS 3
+#define OPEN_BOUNDS_BIT 1
+#define WALL_BIT 2
+
+// Appends `value` as a varint to the events of the recording
+// Returns `false` on error, `true` otherwise
+bool append_varint(Recording *recording, unsigned long long value)
+{
+	// A 64 bit varint takes at most 10 bytes
+	if (recording->events_length + 10 > recording->events_capacity)
+	{
+		size_t capacity = recording->events_capacity * 2 + 64;
+		unsigned char *events = realloc(recording->events, capacity);
+		if (events == NULL)
+		{
+			return false;
+		}
+		recording->events = events;
+		recording->events_capacity = capacity;
+	}
+
+	do
+	{
+		unsigned char byte = value & 0x7f;
+		value >>= 7;
+		recording->events[recording->events_length++] = byte | (value ? 0x80 : 0);
+	} while (value);
+	return true;
+}
+
+void write_varint(FILE *file, unsigned long long value)
+{
+	do
+	{
+		unsigned char byte = value & 0x7f;
+		value >>= 7;
+		fputc(byte | (value ? 0x80 : 0), file);
+	} while (value);
+}
+
+// Reads a varint from `buffer` at `*pos` and advances `*pos`
+// Returns `false` if the buffer ends before the varint does
+bool read_varint(const unsigned char *buffer, size_t length, size_t *pos, unsigned long long *value)
+{
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (*pos >= length)
+			return false;
+
+		unsigned char byte = buffer[(*pos)++];
+		*value |= (unsigned long long)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+void init_recording(Recording *recording, unsigned long long seed, Coord board_size, const GameRules *rules)
+{
+	recording->seed = seed;
+	recording->board_size = board_size;
+	recording->rules = *rules;
+	recording->events = NULL;
+	recording->events_length = 0;
+	recording->events_capacity = 0;
+	recording->event_count = 0;
+	recording->last_tick = 0;
+	recording->final_tick = 0;
+	recording->speed_up = false;
+	recording->failed = false;
+}
+
+void add_event(Recording *recording, long long tick, ReplayEvent event)
+{
+	// A recording that misses an event would play back a different round
+	unsigned long long delta = tick - recording->last_tick;
+	if (recording->failed || !append_varint(recording, (delta << REPLAY_EVENT_BITS) | event))
+	{
+		recording->failed = true;
+		return;
+	}
+	recording->last_tick = tick;
+	recording->event_count++;
+}
+
+void record_step(Recording *recording, long long tick, UserInteraction interaction, bool speed_up)
+{
+	if (speed_up != recording->speed_up)
+	{
+		add_event(recording, tick, speed_up ? REPLAY_SPEED_ON : REPLAY_SPEED_OFF);
+		recording->speed_up = speed_up;
+	}
+
+	switch (interaction)
+	{
+	case DIRECTION_LEFT:
+		add_event(recording, tick, REPLAY_LEFT);
+		break;
+	case DIRECTION_RIGHT:
+		add_event(recording, tick, REPLAY_RIGHT);
+		break;
+	case DIRECTION_UP:
+		add_event(recording, tick, REPLAY_UP);
+		break;
+	case DIRECTION_DOWN:
+		add_event(recording, tick, REPLAY_DOWN);
+		break;
+	default:
+		break;
+	}
+}
+
+bool write_recording(Recording *recording, const char *path, long long final_tick)
+{
+	if (recording->failed)
+	{
+		return false;
+	}
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	recording->final_tick = final_tick;
+
+	// Header
+	fputs(REPLAY_MAGIC, file);
+	fputc(REPLAY_VERSION, file);
+	write_varint(file, recording->seed);
+	write_varint(file, recording->board_size.x);
+	write_varint(file, recording->board_size.y);
+	fputc((recording->rules.open_bounds_flag ? OPEN_BOUNDS_BIT : 0) |
+			  (recording->rules.wall_flag ? WALL_BIT : 0),
+		  file);
+	fputc(recording->rules.wall_pattern, file);
+
+	// Events
+	write_varint(file, recording->event_count);
+	fwrite(recording->events, 1, recording->events_length, file);
+	write_varint(file, final_tick);
+
+	bool ok = !ferror(file);
+	return (fclose(file) == 0) && ok;
+}
+
+void free_recording(Recording *recording)
+{
+	free(recording->events);
+	recording->events = NULL;
+	recording->events_length = 0;
+	recording->events_capacity = 0;
+}
+
+// Decodes the next event of the replay, if there is one left
+void advance_replay(Replay *replay)
+{
+	Recording *recording = &replay->recording;
+	unsigned long long value;
+
+	if (replay->remaining == 0 ||
+		!read_varint(recording->events, recording->events_length, &replay->pos, &value))
+	{
+		replay->remaining = 0;
+		replay->next_tick = -1;
+		return;
+	}
+
+	replay->remaining--;
+	replay->next_tick += value >> REPLAY_EVENT_BITS;
+	replay->next_event = value & ((1 << REPLAY_EVENT_BITS) - 1);
+}
+
+bool open_replay(Replay *replay, const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	// Read the whole file, recordings are small
+	size_t length = 0, capacity = 4096;
+	unsigned char *buffer = malloc(capacity);
+	size_t read;
+	while (buffer != NULL && (read = fread(buffer + length, 1, capacity - length, file)) > 0)
+	{
+		length += read;
+		if (length == capacity)
+		{
+			capacity *= 2;
+			unsigned char *grown = realloc(buffer, capacity);
+			if (grown == NULL)
+			{
+				free(buffer);
+			}
+			buffer = grown;
+		}
+	}
+	fclose(file);
+	if (buffer == NULL)
+	{
+		return false;
+	}
+
+	size_t pos = strlen(REPLAY_MAGIC) + 1;
+	unsigned long long seed, width, height, event_count;
+	if (length < pos + 2 ||
+		memcmp(buffer, REPLAY_MAGIC, strlen(REPLAY_MAGIC)) != 0 ||
+		buffer[pos - 1] != REPLAY_VERSION ||
+		!read_varint(buffer, length, &pos, &seed) ||
+		!read_varint(buffer, length, &pos, &width) ||
+		!read_varint(buffer, length, &pos, &height) ||
+		width == 0 || height == 0 || width > MAX_BOARD_SIZE || height > MAX_BOARD_SIZE ||
+		pos + 2 > length)
+	{
+		free(buffer);
+		return false;
+	}
+
+	GameRules rules;
+	rules.open_bounds_flag = buffer[pos] & OPEN_BOUNDS_BIT;
+	rules.wall_flag = buffer[pos] & WALL_BIT;
+	rules.wall_pattern = buffer[pos + 1];
+	pos += 2;
+	if (rules.wall_flag && (rules.wall_pattern < 1 || rules.wall_pattern > 5))
+	{
+		free(buffer);
+		return false;
+	}
+
+	if (!read_varint(buffer, length, &pos, &event_count))
+	{
+		free(buffer);
+		return false;
+	}
+
+	// The events are kept in the buffer they were read into; skip over
+	// them to find the final tick
+	size_t events_start = pos;
+	unsigned long long value, final_tick;
+	for (unsigned long long i = 0; i < event_count; i++)
+	{
+		if (!read_varint(buffer, length, &pos, &value))
+		{
+			free(buffer);
+			return false;
+		}
+	}
+	size_t events_end = pos;
+	if (!read_varint(buffer, length, &pos, &final_tick))
+	{
+		free(buffer);
+		return false;
+	}
+
+	Recording *recording = &replay->recording;
+	init_recording(recording, seed, coord(width, height), &rules);
+	recording->events = buffer;
+	recording->events_length = events_end;
+	recording->events_capacity = capacity;
+	recording->event_count = event_count;
+	recording->final_tick = final_tick;
+
+	replay->pos = events_start;
+	replay->remaining = event_count;
+	replay->next_tick = 0;
+	advance_replay(replay);
+	return true;
+}
+
+UserInteraction replay_step(Replay *replay, long long tick, bool *speed_up)
+{
+	UserInteraction interaction = NO_INPUT;
+
+	// Several events can happen in the same step
+	while (replay->next_tick == tick)
+	{
+		switch (replay->next_event)
+		{
+		case REPLAY_LEFT:
+			interaction = DIRECTION_LEFT;
+			break;
+		case REPLAY_RIGHT:
+			interaction = DIRECTION_RIGHT;
+			break;
+		case REPLAY_UP:
+			interaction = DIRECTION_UP;
+			break;
+		case REPLAY_DOWN:
+			interaction = DIRECTION_DOWN;
+			break;
+		case REPLAY_SPEED_OFF:
+			*speed_up = false;
+			break;
+		case REPLAY_SPEED_ON:
+			*speed_up = true;
+			break;
+		}
+		advance_replay(replay);
+	}
+
+	return interaction;
+}
+
+void free_replay(Replay *replay)
+{
+	free_recording(&replay->recording);
+}
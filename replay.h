@@ -0,0 +1,98 @@
+// Recording and playback of rounds
+// A recording holds everything needed to play a round again step by step:
+// the seed for the RNG, the board size, the rules and every input that was
+// passed to `step_state`, together with the step it was passed in.
+//
+// File format (all numbers are unsigned LEB128 varints unless noted):
+//   "CSNR"                  magic (4 bytes)
+//   version                 1 byte
+//   seed, width, height
+//   flags                   1 byte (bit 0: open bounds, bit 1: walls)
+//   wall pattern            1 byte
+//   event count
+//   events                  `(ticks since last event << 3) | ReplayEvent`
+//   final tick              amount of steps the round took
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "engine.h"
+
+typedef enum ReplayEvent
+{
+	// Direction inputs
+	REPLAY_LEFT,
+	REPLAY_RIGHT,
+	REPLAY_UP,
+	REPLAY_DOWN,
+	// Speed up was turned off or on (only affects the pace of the round)
+	REPLAY_SPEED_OFF,
+	REPLAY_SPEED_ON
+} ReplayEvent;
+
+typedef struct Recording
+{
+	// Seed the RNG was seeded with at the start of the round
+	unsigned long long seed;
+	// Size of the board
+	Coord board_size;
+	// Rules the round was played with
+	GameRules rules;
+	// Encoded events
+	unsigned char *events;
+	size_t events_length;
+	size_t events_capacity;
+	// Amount of events in `events`
+	long long event_count;
+	// Tick of the last recorded event
+	long long last_tick;
+	// Amount of steps the round took
+	long long final_tick;
+	// Speed up state from the last recorded event
+	bool speed_up;
+	// Whether an event could not be recorded, the recording is not written
+	// then
+	bool failed;
+} Recording;
+
+typedef struct Replay
+{
+	// The recording to play back
+	Recording recording;
+	// Read position in the events of the recording
+	size_t pos;
+	// Amount of events not yet played back
+	long long remaining;
+	// Tick and kind of the next event
+	long long next_tick;
+	ReplayEvent next_event;
+} Replay;
+
+// Starts a new recording
+void init_recording(Recording *recording, unsigned long long seed, Coord board_size, const GameRules *rules);
+
+// Records the input passed to `step_state` in step `tick` and changes of the
+// speed up state. Does nothing for inputs that are not directions.
+void record_step(Recording *recording, long long tick, UserInteraction interaction, bool speed_up);
+
+// Writes the recording to `path`, ending it after `final_tick` steps
+// Returns `false` on error (also if recording an event failed), `true`
+// otherwise
+bool write_recording(Recording *recording, const char *path, long long final_tick);
+
+void free_recording(Recording *recording);
+
+// Reads a recording from `path` and prepares it for playback
+// Returns `false` if the file could not be read or is malformed
+bool open_replay(Replay *replay, const char *path);
+
+// Gets the input to pass to `step_state` in step `tick`, applying recorded
+// changes of the speed up state to `speed_up`
+UserInteraction replay_step(Replay *replay, long long tick, bool *speed_up);
+
+void free_replay(Replay *replay);
+
+#endif
@@ -0,0 +1,400 @@
+// we are using files and threads from POSIX
+// see here: https://www.gnu.org/software/libc/manual/html_node/Feature-Test-Macros.html#index-_005fPOSIX_005fC_005fSOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "savefile.h"
+
+// Layout of the keys of `ScoreSlot`s
+#define KEY_USED 0x80000000u
+#define KEY_OPEN_BOUNDS 0x1u
+#define KEY_WALLS 0x2u
+#define KEY_PATTERN_SHIFT 2
+#define KEY_SIZE_SHIFT 10
+#define KEY_SIZE_MASK (0xffu << KEY_SIZE_SHIFT)
+// Size bucket of highscores that count for every board size
+#define ANY_SIZE 0xffu
+
+uint32_t score_key(const GameRules *rules, Coord board_size)
+{
+	uint32_t key = KEY_USED;
+	if (rules->open_bounds_flag)
+	{
+		key |= KEY_OPEN_BOUNDS;
+	}
+	if (rules->wall_flag)
+	{
+		key |= KEY_WALLS | ((uint32_t)(rules->wall_pattern & 0xff) << KEY_PATTERN_SHIFT);
+	}
+
+	// Index of the highest set bit of the amount of cells
+	uint64_t cells = (uint64_t)board_size.x * board_size.y;
+	uint32_t bucket = 0;
+	while (cells > 1)
+	{
+		cells >>= 1;
+		bucket++;
+	}
+	return key | (bucket << KEY_SIZE_SHIFT);
+}
+
+// Finds the slot holding `key`, or the empty slot it would be stored in
+// Returns the index of the slot or -1 if the table is full
+int find_slot(const ScoreTable *table, uint32_t key)
+{
+	// Fibonacci hashing spreads the few bits that differ between keys
+	uint32_t start = (uint32_t)(((uint64_t)key * 0x9e3779b97f4a7c15ULL) >> 32);
+	for (uint32_t i = 0; i < SCORE_SLOTS; i++)
+	{
+		uint32_t index = (start + i) & (SCORE_SLOTS - 1);
+		if (table->slots[index].key == key || table->slots[index].key == 0)
+		{
+			return index;
+		}
+	}
+	return -1;
+}
+
+long long get_highscore(const ScoreTable *table, uint32_t key)
+{
+	int index = find_slot(table, key);
+	if (index >= 0 && table->slots[index].key == key)
+	{
+		return table->slots[index].score;
+	}
+
+	// The highscore of an old savefile counts until one is set for the board
+	uint32_t any_size = (key & ~KEY_SIZE_MASK) | (ANY_SIZE << KEY_SIZE_SHIFT);
+	index = find_slot(table, any_size);
+	return (index >= 0 && table->slots[index].key == any_size) ? table->slots[index].score : 0;
+}
+
+bool set_highscore(ScoreTable *table, uint32_t key, long long score)
+{
+	int index = find_slot(table, key);
+	if (index < 0)
+	{
+		return false;
+	}
+
+	table->slots[index].key = key;
+	table->slots[index].score = score;
+	return true;
+}
+
+// FNV-1a hash of the slots of `table`
+uint32_t table_checksum(const ScoreTable *table)
+{
+	const unsigned char *bytes = (const unsigned char *)table->slots;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < sizeof(table->slots); i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Appends `suffix` to `path` in newly allocated memory
+// Returns `NULL` on error
+char *path_with_suffix(const char *path, const char *suffix)
+{
+	char *result = malloc(strlen(path) + strlen(suffix) + 1);
+	if (result != NULL)
+	{
+		sprintf(result, "%s%s", path, suffix);
+	}
+	return result;
+}
+
+// Reads the score from the old savefile at `path`
+// Only files holding nothing but up to SCORE_DIGITS digits (and possibly a
+// line break) are valid.
+// Returns `false` if the file can't be read or is not valid, `true` otherwise
+bool read_score_text(const char *path, long long *score)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	// One more character than a valid file may hold is read to find files
+	// that are too long
+	char content[SCORE_DIGITS + 3];
+	size_t length = fread(content, 1, sizeof(content) - 1, file);
+	fclose(file);
+	content[length] = '\0';
+	if (length > 0 && content[length - 1] == '\n')
+	{
+		content[--length] = '\0';
+	}
+
+	if (length == 0 || length > SCORE_DIGITS || strspn(content, "0123456789") != length)
+	{
+		return false;
+	}
+
+	*score = strtoll(content, NULL, 10);
+	return true;
+}
+
+// Reads the table from the savefile at `path`
+// Only files of exactly the size of the table with a matching header and
+// checksum are valid.
+// Returns `false` if the file can't be read or is not valid, `true` otherwise
+bool read_score_table(const char *path, ScoreTable *table)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	unsigned char header[SCORE_HEADER_SIZE];
+	bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+				 fread(table->slots, 1, sizeof(table->slots), file) == sizeof(table->slots) &&
+				 fgetc(file) == EOF;
+	fclose(file);
+
+	uint32_t slot_count, checksum;
+	memcpy(&slot_count, header + 8, sizeof(slot_count));
+	memcpy(&checksum, header + 12, sizeof(checksum));
+	return valid && memcmp(header, SCORE_MAGIC, strlen(SCORE_MAGIC)) == 0 &&
+		   header[strlen(SCORE_MAGIC)] == SCORE_VERSION && slot_count == SCORE_SLOTS &&
+		   checksum == table_checksum(table);
+}
+
+// Reads the table from the savefile at `path`, taking the highscore of an
+// old savefile as the highscore of the default rules on every board size
+// Returns `false` if the file can't be read or is not valid, `true` otherwise
+bool read_any_savefile(const char *path, ScoreTable *table)
+{
+	if (read_score_table(path, table))
+	{
+		return true;
+	}
+
+	long long score;
+	if (!read_score_text(path, &score))
+	{
+		return false;
+	}
+
+	GameRules rules = {.open_bounds_flag = false, .wall_flag = false, .wall_pattern = 0};
+	uint32_t key = (score_key(&rules, coord(1, 1)) & ~KEY_SIZE_MASK) | (ANY_SIZE << KEY_SIZE_SHIFT);
+	memset(table, 0, sizeof(ScoreTable));
+	return set_highscore(table, key, score);
+}
+
+bool read_scores(const char *path, ScoreTable *table)
+{
+	if (read_any_savefile(path, table))
+	{
+		return true;
+	}
+
+	char *backup = path_with_suffix(path, BACKUP_SUFFIX);
+	if (backup == NULL)
+	{
+		return false;
+	}
+
+	bool valid = read_any_savefile(backup, table);
+	if (!valid && access(path, F_OK) != 0 && access(backup, F_OK) != 0)
+	{
+		// Nothing was saved yet
+		memset(table, 0, sizeof(ScoreTable));
+		valid = true;
+	}
+	free(backup);
+	return valid;
+}
+
+// Flushes the directory holding `path` to disk, so renames in it are kept
+// Returns `false` on error, `true` otherwise
+bool sync_directory(const char *path)
+{
+	// `dirname` may change its argument
+	char *copy = path_with_suffix(path, "");
+	if (copy == NULL)
+	{
+		return false;
+	}
+
+	int fd = open(dirname(copy), O_RDONLY);
+	free(copy);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	bool synced = fsync(fd) == 0;
+	close(fd);
+	return synced;
+}
+
+bool write_scores(const char *path, const ScoreTable *table)
+{
+	char *temp = path_with_suffix(path, ".XXXXXX");
+	char *backup = path_with_suffix(path, BACKUP_SUFFIX);
+	if (temp == NULL || backup == NULL)
+	{
+		free(temp);
+		free(backup);
+		return false;
+	}
+
+	unsigned char data[SCORE_HEADER_SIZE + sizeof(table->slots)] = {0};
+	uint32_t slot_count = SCORE_SLOTS, checksum = table_checksum(table);
+	memcpy(data, SCORE_MAGIC, strlen(SCORE_MAGIC));
+	data[strlen(SCORE_MAGIC)] = SCORE_VERSION;
+	memcpy(data + 8, &slot_count, sizeof(slot_count));
+	memcpy(data + 12, &checksum, sizeof(checksum));
+	memcpy(data + SCORE_HEADER_SIZE, table->slots, sizeof(table->slots));
+	size_t length = sizeof(data);
+
+	// Write the table to a new file and wait until it is on disk
+	bool written = false;
+	int fd = mkstemp(temp);
+	if (fd >= 0)
+	{
+		// `mkstemp` only lets the owner read the file, the savefile keeps its mode
+		struct stat old;
+		fchmod(fd, (stat(path, &old) == 0) ? old.st_mode & 0777 : 0644);
+
+		size_t done = 0;
+		while (done < length)
+		{
+			ssize_t result = write(fd, data + done, length - done);
+			if (result < 0 && errno != EINTR)
+			{
+				break;
+			}
+			done += (result > 0) ? result : 0;
+		}
+		written = done == length && fsync(fd) == 0;
+		written = (close(fd) == 0) && written;
+	}
+
+	// Keep the savefile as backup, unless it is damaged and the backup holds
+	// the last good table. Between both renames only the backup exists,
+	// which is read in that case.
+	ScoreTable old_table;
+	if (written && read_any_savefile(path, &old_table))
+	{
+		written = rename(path, backup) == 0;
+	}
+	if (written)
+	{
+		written = rename(temp, path) == 0 && sync_directory(path);
+	}
+
+	if (fd >= 0 && !written)
+	{
+		unlink(temp);
+	}
+	free(temp);
+	free(backup);
+	return written;
+}
+
+void remove_scores(const char *path)
+{
+	remove(path);
+
+	char *backup = path_with_suffix(path, BACKUP_SUFFIX);
+	if (backup != NULL)
+	{
+		remove(backup);
+		free(backup);
+	}
+}
+
+void *run_score_writer(void *arg)
+{
+	ScoreWriter *writer = arg;
+
+	pthread_mutex_lock(&writer->lock);
+	while (true)
+	{
+		while (!writer->has_pending && !writer->quit)
+		{
+			pthread_cond_wait(&writer->wake, &writer->lock);
+		}
+		if (!writer->has_pending)
+		{
+			break;
+		}
+
+		// Tables saved while this one is written wait for the next round
+		ScoreTable table = writer->pending;
+		writer->has_pending = false;
+		pthread_mutex_unlock(&writer->lock);
+
+		bool written = write_scores(writer->path, &table);
+
+		pthread_mutex_lock(&writer->lock);
+		writer->failed = writer->failed || !written;
+	}
+	pthread_mutex_unlock(&writer->lock);
+	return NULL;
+}
+
+bool start_score_writer(ScoreWriter *writer, const char *path)
+{
+	writer->path = path;
+	writer->has_pending = false;
+	writer->quit = false;
+	writer->failed = false;
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_cond_init(&writer->wake, NULL);
+	if (pthread_create(&writer->thread, NULL, run_score_writer, writer) != 0)
+	{
+		pthread_mutex_destroy(&writer->lock);
+		pthread_cond_destroy(&writer->wake);
+		writer->path = NULL;
+		return false;
+	}
+	return true;
+}
+
+void save_scores(ScoreWriter *writer, const ScoreTable *table)
+{
+	if (writer->path == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	writer->pending = *table;
+	writer->has_pending = true;
+	pthread_cond_signal(&writer->wake);
+	pthread_mutex_unlock(&writer->lock);
+}
+
+bool stop_score_writer(ScoreWriter *writer)
+{
+	if (writer->path == NULL)
+	{
+		return true;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	writer->quit = true;
+	pthread_cond_signal(&writer->wake);
+	pthread_mutex_unlock(&writer->lock);
+	pthread_join(writer->thread, NULL);
+
+	pthread_mutex_destroy(&writer->lock);
+	pthread_cond_destroy(&writer->wake);
+	writer->path = NULL;
+	return !writer->failed;
+}
@@ -0,0 +1,112 @@
+// Crash-safe storage of the highscores
+// Every configuration (bounds, walls and a bucket of board sizes) has a
+// highscore of its own, kept in a table of `SCORE_SLOTS` fixed slots. The
+// slot of a configuration is found by hashing its key and probing the
+// following slots, so a highscore is looked up and updated in place in O(1).
+//
+// The table is never written into the savefile itself: it is written to a
+// new file next to it, flushed to disk with `fsync` and then renamed over the
+// savefile, so the savefile always holds a complete table. The savefile it
+// replaces is kept as a backup (`<path>.bak`), which is read instead if the
+// savefile is missing or damaged.
+//
+// Saving happens on a thread of its own, so the game never waits for the
+// disk. Tables saved while an earlier one is still being written replace
+// each other, only the newest one is written.
+//
+// File format:
+//   "CSNS"                  magic (4 bytes)
+//   version                 1 byte
+//   reserved                3 zero bytes
+//   slot count              uint32_t (`SCORE_SLOTS`)
+//   checksum                uint32_t, FNV-1a of the slots
+//   slots                   `ScoreSlot`s in the byte order of the machine
+//
+// Older versions saved a single highscore as 19 decimal digits. Such a
+// savefile is read as the highscore of the default rules on every board
+// size, until a round with them sets a highscore of its own.
+
+#ifndef SAVEFILE_H
+#define SAVEFILE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "engine.h"
+
+#define SCORE_MAGIC "CSNS"
+#define SCORE_VERSION 1
+#define SCORE_HEADER_SIZE 16
+#define SCORE_SLOTS 512 // Power of two
+#define SCORE_DIGITS 19 // Digits of the highscore in old savefiles
+#define BACKUP_SUFFIX ".bak"
+
+typedef struct ScoreSlot
+{
+	// Key of the configuration, see `score_key` (0 for an empty slot)
+	uint32_t key;
+	uint32_t reserved;
+	int64_t score;
+} ScoreSlot;
+
+typedef struct ScoreTable
+{
+	ScoreSlot slots[SCORE_SLOTS];
+} ScoreTable;
+
+typedef struct ScoreWriter
+{
+	// Path to the savefile (`NULL` if the writer was not started)
+	const char *path;
+	pthread_t thread;
+	// Protects everything below
+	pthread_mutex_t lock;
+	// Signaled when a score is saved or the writer has to stop
+	pthread_cond_t wake;
+	// Newest table that has not been written yet
+	ScoreTable pending;
+	bool has_pending;
+	bool quit;
+	// Set once writing a table failed
+	bool failed;
+} ScoreWriter;
+
+// Key of the highscore of rounds with `rules` on a board of `board_size`
+// Boards whose amount of cells has the same power of two share a highscore.
+uint32_t score_key(const GameRules *rules, Coord board_size);
+
+// Returns the highscore of the configuration with `key`, 0 if it has none
+long long get_highscore(const ScoreTable *table, uint32_t key);
+
+// Sets the highscore of the configuration with `key`
+// Returns `false` if the table is full, `true` otherwise
+bool set_highscore(ScoreTable *table, uint32_t key, long long score);
+
+// Reads the highscores from the savefile at `path`, or from its backup if the
+// savefile is missing or damaged
+// Without savefile and backup, the table is empty.
+// Returns `false` if neither holds a valid table, `true` otherwise
+bool read_scores(const char *path, ScoreTable *table);
+
+// Writes `table` to the savefile at `path` and keeps the replaced savefile as
+// its backup, waiting until both are on disk
+// Returns `false` on error, `true` otherwise
+bool write_scores(const char *path, const ScoreTable *table);
+
+// Removes the savefile at `path` and its backup
+void remove_scores(const char *path);
+
+// Starts a thread writing saved tables to the savefile at `path`
+// Returns `false` on error, `true` otherwise
+bool start_score_writer(ScoreWriter *writer, const char *path);
+
+// Hands a copy of `table` to the writer, without waiting for it to be written
+// Does nothing if the writer was not started.
+void save_scores(ScoreWriter *writer, const ScoreTable *table);
+
+// Writes the last saved table, if it wasn't written yet, and stops the writer
+// Returns `false` if writing any table failed, `true` otherwise
+bool stop_score_writer(ScoreWriter *writer);
+
+#endif
@@ -4,176 +4,56 @@
 
 #include <ncurses.h>
 #include <stdbool.h>
-#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 #include <unistd.h>
 #include <time.h>
 #include <pwd.h>
+#include <poll.h>
+
+#include "engine.h"
+#include "replay.h"
+#include "perf.h"
+#include "batch.h"
+#include "autopilot.h"
+#include "bot.h"
+#include "savefile.h"
+#include "history.h"
+#include "render.h"
+#include "broadcast.h"
 
 #define clean_exit(code) \
 	endwin();            \
 	exit(code);
 #define in_range(x, min, max) (x >= min) && (x <= max)
-#define is_timespec_zero(ts) ((ts)->tv_sec == 0 && (ts)->tv_nsec == 0)
-#define set_timespec_zero(ts) \
-	(ts)->tv_sec = 0;         \
-	(ts)->tv_nsec = 0
-#define NANOSECS_IN_SEC 1000000000
-#define NANOSECS_IN_MILLISEC 1000000
 #define TARGET_FRAME_TIME 8333333 // 120 frames per second (NANOSECS_IN_SEC / 120)
-
-// Constants important for gameplay
-#define STARTING_WAIT_TIME 80
-#define WAIT_TIME_DECREMENT 1
-#define MINIMUM_WAIT_TIME 5
-#define STARTING_LENGTH 5
-#define POINTS_COUNTER_VALUE 999
-#define SUPERFOOD_COUNTER_VALUE 10
-#define MIN_POINTS 100
-#define BONUS_DECAY_PER_SECOND 50
-#define GROW_FACTOR 10
-#define SUPERFOOD_GROW_FACTOR 15
-#define GRACE_FRAMES 3
+#define PERF_HUD_INTERVAL 250000000 // Time (in ns) between updates of the performance HUD
+#define MAX_STEP_BACKLOG 100000000 // Time (in ns) of missed steps that is caught up on at most
 
 // Misc. constants
 #define VERSION "0.70.0 (Beta)"
 #define CC_END_YEAR "2026"
 #define STD_FILE_NAME ".csnake"
-#define FILE_LENGTH 20 // 19 characters are needed to display the max number for long long
+#define DEFAULT_HEADLESS_TICKS 1000000
+#define NULL_SCREEN_WIDTH 80 // Size of the terminal the null renderer pretends to draw to
+#define NULL_SCREEN_HEIGHT 24
 
-typedef enum Direction
-{
-	// No direction, standing still
-	HOLD,
-	// Negative y direction
-	UP,
-	// Positive y direction
-	DOWN,
-	// Positive x direction
-	RIGHT,
-	// Negative x direction
-	LEFT
-} Direction;
-
-typedef enum UserInteraction
-{
-	// No interaction by the user
-	NO_INPUT,
-	// Request to pause the game
-	PAUSE,
-	// Request to restart the round
-	RESTART,
-	// Request to quit the program
-	QUIT,
-	// Direction button pressed
-	DIRECTION_LEFT,
-	DIRECTION_RIGHT,
-	DIRECTION_UP,
-	DIRECTION_DOWN
-} UserInteraction;
-
-typedef enum UpdateResult
+// Backends rounds can be drawn with (see render.h)
+typedef enum RendererKind
 {
-	// Player was saved by a grace frame
-	GRACE,
-	// The round ends in a game over
-	GAME_OVER,
-	// The round may continue
-	CONTINUE,
-	// Delayed frame
-	DELAY,
-	// Game should pause
-	PAUSE_GAME,
-	// Game should be quit
-	QUIT_GAME,
-	// Game should restart
-	RESTART_GAME,
-	// No update to be made
-	NO_UPDATE
-} UpdateResult;
-
-typedef struct Coord
-{
-	int x;
-	int y;
-} Coord;
-
-typedef struct LinkedCell
-{
-	// Coordinate for the cell
-	Coord coord;
-	// The previous cell in the linked list
-	// `this->prev->next` should point to `this`
-	struct LinkedCell *prev;
-	// The next cell in the linked list
-	// `this->next->prev` should point to `this`
-	struct LinkedCell *next;
-} LinkedCell;
-
-typedef struct InputQueue
-{
-	// The first input made
-	UserInteraction input;
-	// The next input made
-	struct InputQueue *next;
-} InputQueue;
-
-typedef struct GameState
-{
-	// Current score
-	long long points;
-	// Current direction
-	Direction direction;
-	// Previous direction from the last update
-	Direction old_direction;
-	// Direction that caused a grace frame, to be repeated next frame if not overwritten
-	Direction grace_direction;
-	// Time (in ms) for an update to happen (determines game speed)
-	int wait_time;
-	// Current delay for updating state
-	long frame_delay;
-	// Current position of the snake head
-	Coord pos;
-	// Position of the snake head from the last update
-	Coord old_pos;
-	// Current "bonus" points that would be added if food was hit
-	int points_counter;
-	// Current length of the snake
-	int length;
-	// Current amount of cells the snake still needs to grow
-	int growing;
-	// Amount of available update cycles that
-	int grace_frames;
-	// Amount of update cycles needed until the food becomes a super food
-	int superfood_counter;
-	// Current position of the food
-	Coord food_coord;
-	// Head of the snake
-	LinkedCell *head;
-	// Last cell of the snake
-	LinkedCell *last;
-	// Points to all walls as a single linked list
-	LinkedCell *wall;
-	// All inputs made by the user to be processed
-	InputQueue *input_queue;
-	// Determines whether the game should run faster based on user input
-	bool speed_up;
-	// Base time for round timer display. Set to current time on first movement,
-	// then adjusted forward by pause durations so the displayed elapsed time
-	// does not include time spent paused.
-	struct timespec round_timer;
-	// Time when the current food was spawned (for bonus decay calculation)
-	struct timespec food_timer;
-} GameState;
+	RENDERER_CURSES,
+	RENDERER_ANSI,
+	RENDERER_NULL
+} RendererKind;
 
 typedef struct GameConfiguration
 {
 	// Path to the savefile
 	char *save_file_path;
-	// Highscore either read from savefile or updated from last game round
-	long long highscore;
+	// Highscores of every configuration, either read from savefile or updated
+	// from the last game rounds
+	ScoreTable scores;
 	// Specifies whether outer walls should be open
 	bool open_bounds_flag;
 	// Specifies whether menus should be skipped
@@ -190,11 +70,100 @@ typedef struct GameConfiguration
 	int up_key, down_key, left_key, right_key;
 	// Colorpair index for the color to print the snake in
 	int snake_color;
+	// Specifies whether a round should be simulated without a terminal
+	bool headless_flag;
+	// Board size used for headless rounds
+	Coord headless_size;
+	// Board size used for rounds in the terminal (0x0 to fill the terminal)
+	Coord board_size;
+	// Path to the input script for headless rounds (`NULL` for no input)
+	char *script_path;
+	// Maximum amount of steps a headless round may take
+	long long max_ticks;
+	// Specifies whether the autopilot plays instead of the user or the script
+	bool autopilot_flag;
+	// Specifies whether the lookahead bot plays instead of the user or the script
+	bool bot_flag;
+	// Amount of headless rounds to play as a batch (0 for a single round)
+	long long batch_rounds;
+	// Amount of threads batch rounds are played on
+	int batch_threads;
+	// Path to record rounds to (`NULL` if rounds should not be recorded)
+	char *record_path;
+	// Path to a recording that should be replayed (`NULL` for normal play)
+	char *replay_path;
+	// Specifies whether a replay should run as fast as possible without rendering
+	bool max_speed_flag;
+	// Seed the seeds of all rounds are drawn from
+	uint64_t seed;
+	// Specifies whether the performance HUD should be shown from the start
+	bool perf_hud_flag;
+	// Specifies whether statistics of the round history should be printed
+	bool stats_flag;
+	// Backend rounds are drawn with
+	RendererKind renderer_kind;
+	// Path of the socket rounds are broadcast on (`NULL` if they are not broadcast)
+	char *broadcast_path;
+	// Path of the socket of a broadcast to watch (`NULL` for normal play)
+	char *watch_path;
 } GameConfiguration;
 
+// Part of the board shown in the game window
+typedef struct Viewport
+{
+	// Cell of the board shown in the top left corner of the game window
+	Coord origin;
+	// Amount of cells shown along each side
+	Coord size;
+} Viewport;
+
 // Global configuration (must be initialized with `init_configuration` before use)
 static GameConfiguration *config;
 
+// Recording of the current round (`NULL` if the round is not recorded)
+static Recording *recording = NULL;
+
+// Replay played instead of user input (`NULL` for normal play)
+static Replay *replay = NULL;
+
+// Specifies whether the status bar shows the fields (or the HUD) of the round
+static bool status_valid;
+
+// Draws the rounds (the menus always use ncurses)
+static Renderer *renderer;
+
+// What part of the board the game window currently shows
+static Viewport viewport;
+
+// Writes new highscores to the score file in the background
+static ScoreWriter score_writer;
+
+// Log all rounds are appended to (not open if the savefile is ignored)
+static History history = {-1};
+
+// Spectators of the rounds played (not listening if `fd` is -1)
+static Broadcast broadcast = {-1};
+// Round the spectators are shown while the game waits, the one being played
+// or the last one (`NULL` before the first round)
+static GameState *broadcast_state = NULL;
+
+// Time (in ns) it took to render the frames of the current round
+static LogHistogram frame_times;
+
+// Computer player of the current round (used with `config->autopilot_flag`)
+static Autopilot autopilot;
+
+// Searching computer player (used with `config->bot_flag`)
+static Bot bot;
+
+// Timings of the phases of the game loop, collected once the HUD was shown
+static PerfStats perf_stats;
+static bool perf_enabled = false;
+static bool perf_hud_visible = false;
+
+// Generator for the seeds of the rounds (seeded with `config->seed`)
+static Rng round_seeds;
+
 // Logo generated on http://www.network-science.de/ascii/
 // Used font: nancyj
 static const char *LOGO[] = {
@@ -224,7 +193,7 @@ void init_configuration(void)
 {
 	config = malloc(sizeof(GameConfiguration));
 	config->save_file_path = init_file_path();
-	config->highscore = 0;
+	memset(&config->scores, 0, sizeof(ScoreTable));
 	config->ignore_flag = false;
 	config->remove_flag = false;
 	config->open_bounds_flag = false;
@@ -236,39 +205,38 @@ void init_configuration(void)
 	config->down_key = KEY_DOWN;
 	config->left_key = KEY_LEFT;
 	config->right_key = KEY_RIGHT;
+	config->headless_flag = false;
+	config->headless_size = coord(0, 0);
+	config->board_size = coord(0, 0);
+	config->script_path = NULL;
+	config->max_ticks = DEFAULT_HEADLESS_TICKS;
+	config->autopilot_flag = false;
+	config->bot_flag = false;
+	config->batch_rounds = 0;
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	config->batch_threads = (cores > 0) ? cores : 1;
+	config->record_path = NULL;
+	config->replay_path = NULL;
+	config->max_speed_flag = false;
+	config->seed = time(NULL);
+	config->perf_hud_flag = false;
+	config->stats_flag = false;
+	config->renderer_kind = RENDERER_CURSES;
+	config->broadcast_path = NULL;
+	config->watch_path = NULL;
 }
 
-// Write a score to the score file, reading the file path from the global config
-// Returns `false` on error, `true` otherwise
-bool write_score_file(long long score)
+// Collects the parts of the global config that affect the rules of a round
+GameRules rules_from_configuration(void)
 {
-	// If we ignore the score file we return
-	// If the file path was not initialized we also return
-	if (config->ignore_flag || config->save_file_path == NULL)
-	{
-		return true;
-	}
-
-	// Memory for the string representation of the score
-	char score_str[FILE_LENGTH + 1];
-
-	// Write highscore into memory
-	snprintf(score_str, sizeof(score_str), "%.*lld", FILE_LENGTH - 1, score);
-
-	// Open file
-	FILE *file = fopen(config->save_file_path, "w");
-	if (file == NULL)
-	{
-		return false;
-	}
-
-	// Write score to file and close it
-	fputs(score_str, file);
-	fclose(file);
-	return true;
+	GameRules rules;
+	rules.open_bounds_flag = config->open_bounds_flag;
+	rules.wall_flag = config->wall_flag;
+	rules.wall_pattern = config->wall_pattern;
+	return rules;
 }
 
-// Read the highscore from the score file, reading the file path from the global config
+// Read the highscores from the score file, reading the file path from the global config
 // Returns `false` on error, `true` otherwise
 bool read_score_file(void)
 {
@@ -280,131 +248,178 @@ bool read_score_file(void)
 	if (config->save_file_path == NULL)
 		return true;
 
-	// File doesn't exist
-	if (access(config->save_file_path, F_OK) != 0)
-	{
-		config->highscore = 0;
-		return true;
-	}
+	// A damaged file is replaced by its backup, an old one is migrated
+	return read_scores(config->save_file_path, &config->scores);
+}
 
-	// Memory for file contents
-	char content[FILE_LENGTH];
+// Path of the round history next to the score file
+// Returns `NULL` on error
+char *history_file_path(void)
+{
+	if (config->save_file_path == NULL)
+		return NULL;
 
-	// Open file
-	FILE *file = fopen(config->save_file_path, "r");
-	if (file == NULL)
+	char *path = malloc(strlen(config->save_file_path) + strlen(HISTORY_SUFFIX) + 1);
+	if (path != NULL)
 	{
-		config->highscore = 0;
-		return false;
+		sprintf(path, "%s%s", config->save_file_path, HISTORY_SUFFIX);
 	}
-
-	// Read file contents and interpret the score
-	if (fgets(content, FILE_LENGTH, file) == NULL)
-		config->highscore = 0;
-	else
-		config->highscore = atoll(content);
-
-	// Close the file
-	fclose(file);
-	return true;
+	return path;
 }
 
-inline Coord coord(int x, int y)
+// Disconnects the spectators and removes the socket before the program ends
+void finish_broadcast(void)
 {
-	Coord coord;
-	coord.x = x;
-	coord.y = y;
-	return coord;
+	close_broadcast(&broadcast);
 }
 
-inline Coord get_max_coords(WINDOW *win)
+// Waits for the last highscore to be written before the program ends
+void finish_score_file(void)
 {
-	return coord(getmaxx(win), getmaxy(win));
+	if (!stop_score_writer(&score_writer))
+	{
+		fprintf(stderr, "Unable to write savefile at %s\n", config->save_file_path);
+	}
 }
 
-inline size_t half_len(const char string[])
+static inline size_t half_len(const char string[])
 {
 	return strlen(string) / 2;
 }
 
-// Adds `t2` to `t1` in place, normalizing nsecs to [0, NANOSECS_IN_SEC)
-void add_timespec(struct timespec *t1, struct timespec *t2)
+// Reads the monotonic clock in nanoseconds
+long long monotonic_ns(void)
 {
-	t1->tv_sec += t2->tv_sec;
-	t1->tv_nsec += t2->tv_nsec;
-	if (t1->tv_nsec >= NANOSECS_IN_SEC)
-	{
-		t1->tv_sec++;
-		t1->tv_nsec -= NANOSECS_IN_SEC;
-	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * NANOSECS_IN_SEC + now.tv_nsec;
 }
 
-// Subtracts `t2` from `t1` assuming that `t1` > `t2`
-struct timespec subtract_timespec(struct timespec *t1, struct timespec *t2)
+// Waits until the user presses a key (if `keys` is set) or `timeout`
+// nanoseconds have passed, a negative timeout waits without any time limit
+// Spectators are served whenever their sockets wake the game in the meantime.
+void wait_for_events(long long timeout, bool keys)
 {
-	struct timespec diff;
-	diff.tv_sec = t1->tv_sec - t2->tv_sec;
-	long new_nsec = t1->tv_nsec - t2->tv_nsec;
-	if (new_nsec < 0)
-	{
-		diff.tv_sec--;
-		diff.tv_nsec = NANOSECS_IN_SEC + new_nsec;
-	}
-	else
-	{
-		diff.tv_nsec = new_nsec;
-	}
-	return diff;
-}
+	// The terminal and the sockets of the broadcast, grown with the subscribers
+	static struct pollfd *sources = NULL;
+	static int source_capacity = 0;
+	long long deadline = monotonic_ns() + timeout;
 
-void delay_frame(struct timespec *start_timer, struct timespec *end_timer)
-{
-	struct timespec wait_time, rem, delta = subtract_timespec(end_timer, start_timer);
-	if (delta.tv_sec == 0)
-	{
-		long nano_delay = TARGET_FRAME_TIME - delta.tv_nsec;
-		wait_time.tv_sec = 0;
-		wait_time.tv_nsec = nano_delay;
-		nanosleep(&wait_time, &rem);
-	}
-	else
+	while (true)
 	{
-		// We are already under 1 frame per second, no reason to delay!
+		// Without room for the sockets of the broadcast only the terminal is
+		// waited for, the spectators are served once there is room again
+		bool grown = source_capacity >= broadcast.subscriber_count + 2;
+		if (!grown)
+		{
+			struct pollfd *resized = realloc(sources, (broadcast.subscriber_count + 2) * sizeof(struct pollfd));
+			if (resized != NULL)
+			{
+				sources = resized;
+				source_capacity = broadcast.subscriber_count + 2;
+				grown = true;
+			}
+		}
+
+		int count = 0;
+		struct pollfd terminal;
+		struct pollfd *polled = (source_capacity > 0) ? sources : &terminal;
+		if (keys && (renderer->interactive || timeout < 0))
+		{
+			polled[count].fd = STDIN_FILENO;
+			polled[count++].events = POLLIN;
+		}
+		int terminal_count = count;
+		if (grown)
+		{
+			count += broadcast_poll_fds(&broadcast, polled + count);
+		}
+
+		long long remaining = deadline - monotonic_ns();
+		if (timeout >= 0 && (remaining < NANOSECS_IN_MILLISEC || count == 0))
+		{
+			// Less than a millisecond is too short to wait for input, without
+			// a terminal or spectators there is nothing to wait for
+			if (remaining > 0)
+			{
+				struct timespec wait_time, rem;
+				wait_time.tv_sec = remaining / NANOSECS_IN_SEC;
+				wait_time.tv_nsec = remaining % NANOSECS_IN_SEC;
+				nanosleep(&wait_time, &rem);
+			}
+			return;
+		}
+
+		// poll only takes milliseconds, the rest is waited for by the next call
+		if (poll(polled, count, (timeout < 0) ? -1 : remaining / NANOSECS_IN_MILLISEC) <= 0)
+		{
+			return;
+		}
+
+		bool pressed = terminal_count > 0 && polled[0].revents != 0;
+		bool served = false;
+		for (int i = terminal_count; i < count; i++)
+		{
+			served = served || polled[i].revents != 0;
+		}
+		if (served)
+		{
+			serve_broadcast(&broadcast, broadcast_state);
+		}
+		if (pressed || !served)
+		{
+			return;
+		}
 	}
 }
 
-// Format time as MM:SS:CC (minutes, seconds, centiseconds)
-void format_timespec(char *buffer, size_t bufsize, struct timespec *elapsed)
+// Waits until the user presses a key or `timeout` nanoseconds have passed
+// A negative timeout waits for a key without any time limit
+void wait_for_input(long long timeout)
 {
-	int minutes = elapsed->tv_sec / 60;
-	int seconds = elapsed->tv_sec % 60;
-	int centiseconds = elapsed->tv_nsec / 10000000; // Convert nanoseconds to centiseconds (2 digits)
-	snprintf(buffer, bufsize, "%02d:%02d:%02d", minutes, seconds, centiseconds);
+	wait_for_events(timeout, true);
 }
 
-// Calculate current bonus based on elapsed time since food was spawned
-int calculate_current_bonus(struct timespec *food_timer)
+// Waits for the user to press a key and returns it
+// getch doesn't block, so the spectators are served in the meantime.
+int wait_for_key(void)
 {
-	// If food timer hasn't started yet (all zeros), return full bonus
-	if (is_timespec_zero(food_timer))
+	timeout(0);
+	int key;
+	while ((key = getch()) == ERR)
 	{
-		return POINTS_COUNTER_VALUE;
+		wait_for_input(-1);
 	}
+	return key;
+}
 
-	struct timespec now;
-	clock_gettime(CLOCK_REALTIME, &now);
-	struct timespec elapsed = subtract_timespec(&now, food_timer);
+// Prints the timing histograms when the program exits
+void print_perf_stats_at_exit(void)
+{
+	print_perf_histogram(&perf_stats, stderr);
+}
 
-	// Convert to centiseconds for smooth decay calculation
-	long elapsed_centis = elapsed.tv_sec * 100 + elapsed.tv_nsec / 10000000;
-	long total_decay = (elapsed_centis * BONUS_DECAY_PER_SECOND) / 100;
+// Starts timing a phase of the game loop
+static inline long long start_phase(void)
+{
+	return perf_enabled ? monotonic_ns() : 0;
+}
 
-	int current_bonus = POINTS_COUNTER_VALUE - total_decay;
-	if (current_bonus < MIN_POINTS)
+// Ends timing a phase of the game loop started with `start_phase`
+static inline void end_phase(PerfPhase phase, long long start)
+{
+	if (perf_enabled && start != 0)
 	{
-		current_bonus = MIN_POINTS;
+		record_phase(&perf_stats, phase, monotonic_ns() - start);
 	}
-	return current_bonus;
+}
+
+// Format a time (in ns) as MM:SS:CC (minutes, seconds, centiseconds)
+void format_round_time(char *buffer, size_t bufsize, long long nanos)
+{
+	long long seconds = nanos / NANOSECS_IN_SEC;
+	int centiseconds = (nanos % NANOSECS_IN_SEC) / (10 * NANOSECS_IN_MILLISEC);
+	snprintf(buffer, bufsize, "%02lld:%02lld:%02d", seconds / 60, seconds % 60, centiseconds);
 }
 
 void print_centered(WINDOW *window, int y, const char string[])
@@ -421,520 +436,402 @@ void print_offset(WINDOW *window, int x_offset, int y, const char string[])
 	mvwaddstr(window, y, x + x_offset, string);
 }
 
-void print_status(WINDOW *status_win, GameState *state, struct timespec *elapsed)
+// Marks the content of the status bar as unknown, so the next call of
+// `print_status` redraws it completely
+void invalidate_status(void)
 {
-	char txt_buf[50];
-	int max_x = getmaxx(status_win);
-
-	// Set normal
-	wattrset(status_win, A_BOLD);
-
-	// Deleting rows
-	wmove(status_win, 1, 0);
-	wclrtoeol(status_win);
-	wmove(status_win, 2, 0);
-	wclrtoeol(status_win);
-
-	// Redrawing the box
-	box(status_win, 0, 0);
+	status_valid = false;
+}
 
-	// Set bold font
-	wattrset(status_win, A_BOLD);
+// Updates the status bar, the renderer only touches fields whose text changed
+// The status bar is not put on the screen, this is left to the next `present`
+void print_status(GameState *state)
+{
+	char txt_buf[50];
 
-	if (max_x > 50)
+	if (!status_valid)
 	{
-		// Print bonus (left third, row 1) - dynamically calculated based on time
-		int current_bonus = calculate_current_bonus(&state->food_timer);
-		sprintf(txt_buf, "Bonus: %d", current_bonus);
-		mvwaddstr(status_win, 1, (max_x / 3) - half_len(txt_buf), txt_buf);
+		renderer->ops->clear_status(renderer);
+		status_valid = true;
+	}
 
-		// Print time (right third, row 1) - same format as timer
-		if (elapsed != NULL)
-		{
-			char time_buf[20];
-			format_timespec(time_buf, sizeof(time_buf), elapsed);
-			sprintf(txt_buf, "Time: %s", time_buf);
-		}
-		else
-		{
-			sprintf(txt_buf, "Time: --:--:--");
-		}
-		mvwaddstr(status_win, 1, (2 * max_x / 3) - half_len(txt_buf), txt_buf);
+	// Print bonus - dynamically calculated based on time
+	int current_bonus = calculate_current_bonus(state);
+	sprintf(txt_buf, "Bonus: %d", current_bonus);
+	renderer->ops->status_field(renderer, STATUS_BONUS, txt_buf);
 
-		// Print score (left third, row 2)
-		sprintf(txt_buf, "Score: %lld", state->points);
-		mvwaddstr(status_win, 2, (max_x / 3) - half_len(txt_buf), txt_buf);
+	// Print score
+	sprintf(txt_buf, "Score: %lld", state->points);
+	renderer->ops->status_field(renderer, STATUS_SCORE, txt_buf);
 
-		// Print highscore (right third, row 2)
-		if (config->highscore != 0)
-		{
-			sprintf(txt_buf, "Highscore: %lld", config->highscore);
-		}
-		else
-		{
-			sprintf(txt_buf, "No highscore set");
-		}
-		mvwaddstr(status_win, 2, (2 * max_x / 3) - half_len(txt_buf), txt_buf);
+	// Print time - same format as timer
+	if (state->round_start >= 0)
+	{
+		char time_buf[32];
+		format_round_time(time_buf, sizeof(time_buf), round_time(state));
+		sprintf(txt_buf, "Time: %s", time_buf);
 	}
 	else
 	{
-		// Print bonus (row 1) - dynamically calculated based on time
-		int current_bonus = calculate_current_bonus(&state->food_timer);
-		sprintf(txt_buf, "Bonus: %d", current_bonus);
-		mvwaddstr(status_win, 1, (max_x / 2) - half_len(txt_buf), txt_buf);
-
-		// Print score (row 2)
-		sprintf(txt_buf, "Score: %lld", state->points);
-		mvwaddstr(status_win, 2, (max_x / 2) - half_len(txt_buf), txt_buf);
+		sprintf(txt_buf, "Time: --:--:--");
 	}
+	renderer->ops->status_field(renderer, STATUS_TIME, txt_buf);
 
-	// Refresh window
-	wrefresh(status_win);
-}
-
-void pause_game(WINDOW *status_win, const char string[], const int seconds)
-{
-	// Clear status window
-	wclear(status_win);
-
-	// Redrawing the box
-	box(status_win, 0, 0);
-
-	// Print the message
-	print_centered(status_win, 1, string);
-
-	// Refresh the window
-	wrefresh(status_win);
-
-	// Pausing for 0 seconds means waiting for input
-	if (seconds == 0)
+	// Print highscore of the rules and board of the round
+	long long highscore = get_highscore(&config->scores, score_key(&state->rules, state->board_size));
+	if (highscore != 0)
 	{
-		timeout(-1); // getch is in blocking mode
-		getch();
-		timeout(0); // reset blocking mode
+		sprintf(txt_buf, "Highscore: %lld", highscore);
 	}
 	else
 	{
-		sleep(seconds);
-		flushinp(); // Flush typeahead during sleep
+		sprintf(txt_buf, "No highscore set");
 	}
-	// Clear window
-	wclear(status_win);
-
-	// Redrawing the box
-	wattrset(status_win, A_BOLD);
-	box(status_win, 0, 0);
-
-	// Refreshing the window
-	wrefresh(status_win);
+	renderer->ops->status_field(renderer, STATUS_HIGHSCORE, txt_buf);
 }
 
-bool is_on_obstacle(LinkedCell *test_cell, const int x, const int y)
+// Shows min/avg/p99 of the recent timings of every phase of the game loop
+// in place of the status fields, updated every PERF_HUD_INTERVAL
+void print_perf_hud(void)
 {
-	// Not a valid cell to test
-	if (test_cell == NULL)
-		return false;
-
-	do
+	static long long last_update = 0;
+	long long now = monotonic_ns();
+	if (status_valid && now - last_update < PERF_HUD_INTERVAL)
 	{
-		// A cell has the same coordinates as the point to check
-		if ((test_cell->coord.x == x) && (test_cell->coord.y == y))
-			return true;
-
-		// Check next cell
-		test_cell = test_cell->prev;
-	} while (test_cell != NULL);
-
-	// No cell found
-	return false;
-}
-
-void new_random_coordinates(
-	LinkedCell *snake,
-	LinkedCell *wall,
-	Coord *coord,
-	Coord max_coords)
-{
-	int x, y;
-	do
-	{
-		// Generate random coordinates
-		x = rand() % max_coords.x;
-		y = rand() % max_coords.y;
+		return;
+	}
+	last_update = now;
 
-		// Check if the coordinates are on the snake or wall
-		// If so, generate new values
-	} while (is_on_obstacle(snake, x, y) || is_on_obstacle(wall, x, y));
+	renderer->ops->clear_status(renderer);
 
-	// Save coordinates
-	coord->x = x;
-	coord->y = y;
-}
+	char txt_buf[50], min_buf[16], avg_buf[16], p99_buf[16];
+	int column_width = (renderer->status_width - 2) / 3;
 
-LinkedCell *create_wall(int start, int end, int constant, Direction dir, LinkedCell *last_cell)
-{
-	int i;
-	LinkedCell *new_wall, *wall = malloc(sizeof(LinkedCell));
+	// Title with the amount of frames over the target frame time
+	snprintf(txt_buf, sizeof(txt_buf), " min/avg/p99 - %lld of %lld frames over ", perf_stats.overruns, perf_stats.frames);
+	renderer->ops->status_text(renderer, 0, 2, txt_buf, renderer->status_width - 4);
 
-	// Based on the direction set either x or y to a constant value
-	if ((dir == LEFT) || (dir == RIGHT))
+	// Three phases per row
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
 	{
-		wall->coord = coord(start, constant);
-	}
-	else
-	{
-		wall->coord = coord(constant, start);
+		PhaseSummary summary = summarize_phase(&perf_stats.phases[phase]);
+		format_duration(min_buf, sizeof(min_buf), summary.min);
+		format_duration(avg_buf, sizeof(avg_buf), summary.avg);
+		format_duration(p99_buf, sizeof(p99_buf), summary.p99);
+		snprintf(txt_buf, sizeof(txt_buf), "%s %s/%s/%s", phase_name(phase), min_buf, avg_buf, p99_buf);
+		renderer->ops->status_text(renderer, 1 + phase / 3, 1 + (phase % 3) * column_width + 1, txt_buf, column_width - 1);
 	}
 
-	// Connect the new wall to an old one
-	// If last_cell is NULL the list ends here
-	wall->prev = last_cell;
+	// The status bar is up to date until the HUD is hidden again
+	status_valid = true;
+}
 
-	// Based on the direction build a wall from start to end
-	// and put it infrnt of the old list
-	switch (dir)
+// Shows or hides the performance HUD, timings are collected from the first
+// time it is shown until the program exits
+void toggle_perf_hud(void)
+{
+	if (!perf_enabled)
 	{
-	case UP:
-		for (i = start - 1; i > end; i--)
-		{
-			new_wall = malloc(sizeof(LinkedCell));
-			new_wall->coord = coord(constant, i);
-			new_wall->prev = wall;
-			wall = new_wall;
-		}
-		break;
-	case DOWN:
-		for (i = start + 1; i < end; i++)
-		{
-			new_wall = malloc(sizeof(LinkedCell));
-			new_wall->coord = coord(constant, i);
-			new_wall->prev = wall;
-			wall = new_wall;
-		}
-		break;
-	case LEFT:
-		for (i = start - 1; i > end; i--)
-		{
-			new_wall = malloc(sizeof(LinkedCell));
-			new_wall->coord = coord(i, constant);
-			new_wall->prev = wall;
-			wall = new_wall;
-		}
-		break;
-	case RIGHT:
-		for (i = start + 1; i < end; i++)
-		{
-			new_wall = malloc(sizeof(LinkedCell));
-			new_wall->coord = coord(i, constant);
-			new_wall->prev = wall;
-			wall = new_wall;
-		}
-		break;
-	case HOLD:
-		break;
+		init_perf_stats(&perf_stats);
+		atexit(print_perf_stats_at_exit);
+		perf_enabled = true;
 	}
+	perf_hud_visible = !perf_hud_visible;
 
-	return wall;
+	// The status bar has to be redrawn with either the HUD or the fields
+	invalidate_status();
 }
 
-void free_linked_list(LinkedCell *cell)
+// Shows `string` in place of the status bar for `seconds`, pausing for 0
+// seconds means waiting for input
+// Without a terminal nobody reads the message, so the game doesn't wait.
+void pause_game(const char string[], MessageTone tone, const int seconds)
 {
-	// Nothing valid to free
-	if (cell == NULL)
-		return;
+	renderer->ops->show_message(renderer, string, tone);
 
-	// Free list
-	LinkedCell *tmp_cell;
-	do
+	if (renderer->interactive && seconds == 0)
 	{
-		tmp_cell = cell->prev;
-		free(cell);
-		cell = tmp_cell;
-	} while (cell != NULL);
-}
-
-void free_queue(InputQueue *queue)
-{
-	// Nothing valid to free
-	if (queue == NULL)
-		return;
-
-	// Free queue
-	InputQueue *tmp_queue;
-	do
+		wait_for_key();
+	}
+	else if (renderer->interactive)
 	{
-		tmp_queue = queue->next;
-		free(queue);
-		queue = tmp_queue;
-	} while (queue != NULL);
+		wait_for_events((long long)seconds * NANOSECS_IN_SEC, false);
+		flushinp(); // Flush typeahead during sleep
+	}
+
+	// The fields have to be printed again
+	invalidate_status();
 }
 
-int snake_char_from_direction(Direction direction, Direction old_direction)
+// Glyph of the part of the body the snake moved through into `direction`
+// after moving into `old_direction`
+Glyph body_glyph(Direction direction, Direction old_direction)
 {
 	if (direction == UP)
 	{
 		if (old_direction == LEFT)
 		{
-			return ACS_LLCORNER;
+			return GLYPH_BODY_LOWER_LEFT;
 		}
 		else if (old_direction == RIGHT)
 		{
-			return ACS_LRCORNER;
+			return GLYPH_BODY_LOWER_RIGHT;
 		}
 		else
 		{
-			return ACS_VLINE;
+			return GLYPH_BODY_VERTICAL;
 		}
 	}
 	else if (direction == DOWN)
 	{
 		if (old_direction == LEFT)
 		{
-			return ACS_ULCORNER;
+			return GLYPH_BODY_UPPER_LEFT;
 		}
 		else if (old_direction == RIGHT)
 		{
-			return ACS_URCORNER;
+			return GLYPH_BODY_UPPER_RIGHT;
 		}
 		else
 		{
-			return ACS_VLINE;
+			return GLYPH_BODY_VERTICAL;
 		}
 	}
 	else if (direction == LEFT)
 	{
 		if (old_direction == UP)
 		{
-			return ACS_URCORNER;
+			return GLYPH_BODY_UPPER_RIGHT;
 		}
 		else if (old_direction == DOWN)
 		{
-			return ACS_LRCORNER;
+			return GLYPH_BODY_LOWER_RIGHT;
 		}
 		else
 		{
-			return ACS_HLINE;
+			return GLYPH_BODY_HORIZONTAL;
 		}
 	}
-	else if (direction == RIGHT)
+	else
 	{
 		if (old_direction == UP)
 		{
-			return ACS_ULCORNER;
+			return GLYPH_BODY_UPPER_LEFT;
 		}
 		else if (old_direction == DOWN)
 		{
-			return ACS_LLCORNER;
+			return GLYPH_BODY_LOWER_LEFT;
 		}
 		else
 		{
-			return ACS_HLINE;
+			return GLYPH_BODY_HORIZONTAL;
 		}
 	}
-	return 0;
 }
 
-bool update_position(GameState *state, Direction direction, Coord max_coord)
+// Gets all pending user inputs and adds them to the input queue
+// Returns `true` if the performance HUD was toggled, `false` otherwise
+bool get_input(GameState *state)
 {
-	switch (direction)
-	{
-	case UP:
-		state->pos.y--;
-		break;
-	case DOWN:
-		state->pos.y++;
-		break;
-	case LEFT:
-		state->pos.x--;
-		break;
-	case RIGHT:
-		state->pos.x++;
-		break;
-	case HOLD:
-		return false;
-	default:
-		break;
-	}
-
-	if (config->open_bounds_flag)
+	bool hud_toggled = false;
+	int key;
+	while (renderer->interactive && (key = getch()) != ERR)
 	{
-		// If you hit the outer bounds you'll end up on the other side
-		if (state->pos.y < 0)
+		UserInteraction input = NO_INPUT;
+
+		// Changing direction according to the input
+		if (key == config->left_key)
 		{
-			state->pos.y = max_coord.y - 1;
+			input = DIRECTION_LEFT;
 		}
-		else if (state->pos.y >= max_coord.y)
+		else if (key == config->right_key)
 		{
-			state->pos.y = 0;
+			input = DIRECTION_RIGHT;
 		}
-		else if (state->pos.x < 0)
+		else if (key == config->up_key)
 		{
-			state->pos.x = max_coord.x - 1;
+			input = DIRECTION_UP;
 		}
-		else if (state->pos.x >= max_coord.x)
+		else if (key == config->down_key)
 		{
-			state->pos.x = 0;
+			input = DIRECTION_DOWN;
 		}
-		return false;
-	}
-	else
-	{
-		return (state->pos.y < 0) || (state->pos.x < 0) || (state->pos.y >= max_coord.y) || (state->pos.x >= max_coord.x);
+		else if (key == '\n') // Enter-key
+		{
+			input = PAUSE;
+		}
+		else if (key == 'R')
+		{
+			input = RESTART;
+		}
+		else if (key == 'Q')
+		{
+			input = QUIT;
+		}
+		else if (key == 'P')
+		{
+			// Only affects the display, so it is not queued
+			toggle_perf_hud();
+			hud_toggled = true;
+		}
+
+		// During a replay only pausing and quitting are possible
+		if (replay != NULL && input != PAUSE && input != QUIT)
+		{
+			input = NO_INPUT;
+		}
+
+		// Check if double-input in a certain direction happened and enable speed up,
+		// a replay takes the speed up from the recording
+		if (replay == NULL)
+		{
+			check_speed_up(input, state);
+		}
+
+		// Push input into input queue
+		push_input(input, state);
 	}
+	return hud_toggled;
 }
 
-UserInteraction pop_current_input(GameState *state)
+// Gets the position of `cell` in the game area
+// Returns `false` if the viewport doesn't show the cell, `true` otherwise
+bool viewport_position(GameState *state, Coord cell, Coord *position)
 {
-	if (state->input_queue != NULL)
-	{
-		UserInteraction input = state->input_queue->input;
-		InputQueue *next = state->input_queue->next;
-		free(state->input_queue);
-		state->input_queue = next;
-		return input;
-	}
-	else
-	{
-		return NO_INPUT;
-	}
+	// With open bounds the viewport may wrap around the board, so positions
+	// are taken modulo the board size
+	position->x = ((cell.x - viewport.origin.x) % state->board_size.x + state->board_size.x) % state->board_size.x;
+	position->y = ((cell.y - viewport.origin.y) % state->board_size.y + state->board_size.y) % state->board_size.y;
+	return position->x < viewport.size.x && position->y < viewport.size.y;
 }
 
-void check_speed_up(UserInteraction input, GameState *state)
+// Paints `glyph` at `cell`, if the viewport shows it
+void paint_cell(GameState *state, Coord cell, Glyph glyph)
 {
-	if ((input == DIRECTION_LEFT && state->direction == LEFT) ||
-		(input == DIRECTION_RIGHT && state->direction == RIGHT) ||
-		(input == DIRECTION_UP && state->direction == UP) ||
-		(input == DIRECTION_DOWN && state->direction == DOWN))
+	Coord position;
+	if (viewport_position(state, cell, &position))
 	{
-		state->speed_up = true;
-	}
-	else if (input != NO_INPUT)
-	{
-		state->speed_up = false;
+		renderer->ops->draw_cell(renderer, position, glyph);
 	}
 }
 
-void push_input(UserInteraction input, GameState *state)
+// Moves the viewport along one axis so the head stays at least a quarter of
+// the viewport away from its edges, centering the head when it gets closer
+// Returns the new origin of the viewport on the axis.
+int follow_axis(int origin, int head, int view, int board, bool wrap)
 {
-	if (input == NO_INPUT)
+	// The whole axis is shown
+	if (view >= board)
 	{
-		return;
+		return 0;
 	}
-	InputQueue *new = malloc(sizeof(InputQueue));
-	new->input = input;
-	new->next = NULL;
 
-	if (state->input_queue == NULL)
+	int position = ((head - origin) % board + board) % board;
+	if (position >= view / 4 && position < view - view / 4)
 	{
-		state->input_queue = new;
+		return origin;
 	}
-	else
+
+	origin = head - view / 2;
+	if (wrap)
 	{
-		InputQueue *queue = state->input_queue;
-		while (true)
-		{
-			if (queue->next == NULL)
-			{
-				if (queue->input == input)
-				{
-					// We don't store the same input multiple times
-					return;
-				}
-				else if ((queue->input == DIRECTION_LEFT && input == DIRECTION_RIGHT) ||
-						 (queue->input == DIRECTION_RIGHT && input == DIRECTION_LEFT) ||
-						 (queue->input == DIRECTION_UP && input == DIRECTION_DOWN) ||
-						 (queue->input == DIRECTION_DOWN && input == DIRECTION_UP))
-				{
-					// We don't store opposite directions as they are illegal
-					return;
-				}
-				queue->next = new;
-				return;
-			}
-			else
-			{
-				queue = queue->next;
-			}
-		}
+		return (origin % board + board) % board;
 	}
+	return (origin < 0) ? 0 : ((origin > board - view) ? board - view : origin);
 }
 
-// Gets the next user input and adds it to the input queue
-void get_input(GameState *state)
+// Moves the viewport along with the head of the snake
+// Returns `true` if the viewport moved, `false` otherwise
+bool follow_head(GameState *state)
 {
-	int key = getch();
-	UserInteraction input = NO_INPUT;
-
-	// Changing direction according to the input
-	if (key == config->left_key)
-	{
-		input = DIRECTION_LEFT;
-	}
-	else if (key == config->right_key)
-	{
-		input = DIRECTION_RIGHT;
-	}
-	else if (key == config->up_key)
-	{
-		input = DIRECTION_UP;
-	}
-	else if (key == config->down_key)
-	{
-		input = DIRECTION_DOWN;
-	}
-	else if (key == '\n') // Enter-key
-	{
-		input = PAUSE;
-	}
-	else if (key == 'R')
-	{
-		input = RESTART;
-	}
-	else if (key == 'Q')
-	{
-		input = QUIT;
-	}
-
-	// Check if double-input in a certain direction happened and enable speed up
-	check_speed_up(input, state);
-
-	// Push input into input queue
-	push_input(input, state);
+	Coord origin = viewport.origin;
+	bool wrap = state->rules.open_bounds_flag;
+	viewport.origin.x = follow_axis(origin.x, state->pos.x, viewport.size.x, state->board_size.x, wrap);
+	viewport.origin.y = follow_axis(origin.y, state->pos.y, viewport.size.y, state->board_size.y, wrap);
+	return viewport.origin.x != origin.x || viewport.origin.y != origin.y;
 }
 
-void paint_objects(WINDOW *game_win, GameState *state)
+void paint_objects(GameState *state)
 {
 	// Paint food
-	wattrset(game_win, COLOR_PAIR((state->superfood_counter == 0) ? 4 : 3) | A_BOLD);
-	mvwaddch(game_win, state->food_coord.y, state->food_coord.x, '0');
-	// Paint the snake in the specified color
-	wattrset(game_win, COLOR_PAIR(config->snake_color) | A_BOLD);
-	int snake_char = snake_char_from_direction(state->direction, state->old_direction);
-	if (snake_char)
+	paint_cell(state, state->food_coord, (state->superfood_counter == 0) ? GLYPH_SUPERFOOD : GLYPH_FOOD);
+	// Paint the part of the body the head left
+	if (state->direction != HOLD)
 	{
-		mvwaddch(game_win, state->old_pos.y, state->old_pos.x, snake_char);
+		paint_cell(state, state->old_pos, body_glyph(state->direction, state->old_direction));
 	}
 	// Draw head
-	mvwaddch(game_win, state->pos.y, state->pos.x, 'X');
+	paint_cell(state, state->pos, GLYPH_HEAD);
 }
 
-UpdateResult update_state(WINDOW *game_win, WINDOW *status_win, GameState *state)
+// Paints the part of a wall segment the viewport shows
+// The viewport covers [origin, origin + size) of each axis modulo the board,
+// so a segment is drawn as at most two runs: up to the end of the board and
+// from its start on, if the viewport wraps around.
+void paint_wall_segment(GameState *state, const WallSegment *segment)
 {
-	// Update frame delay; either reset it and continue or decrement it and return
-	if (state->frame_delay > 0)
+	bool vertical = segment->vertical;
+	int board = vertical ? state->board_size.y : state->board_size.x;
+	int origin = vertical ? viewport.origin.y : viewport.origin.x;
+	int view = vertical ? viewport.size.y : viewport.size.x;
+	int start = vertical ? segment->start.y : segment->start.x;
+
+	// Position of the segment across its axis
+	int cross_board = vertical ? state->board_size.x : state->board_size.y;
+	int cross = vertical ? segment->start.x - viewport.origin.x : segment->start.y - viewport.origin.y;
+	cross = (cross % cross_board + cross_board) % cross_board;
+	if (cross >= (vertical ? viewport.size.x : viewport.size.y))
 	{
-		state->frame_delay -= TARGET_FRAME_TIME;
-		return DELAY;
+		return;
 	}
-	else
+
+	int lows[] = {origin, 0};
+	int highs[] = {(origin + view < board) ? origin + view : board, origin + view - board};
+	for (int i = 0; i < 2; i++)
 	{
-		state->frame_delay = state->wait_time * NANOSECS_IN_MILLISEC;
-		if (state->speed_up)
+		int low = (start > lows[i]) ? start : lows[i];
+		int high = (start + segment->length < highs[i]) ? start + segment->length : highs[i];
+		if (low < high)
 		{
-			state->frame_delay = state->frame_delay / 3;
+			int along = (low - origin + board) % board;
+			renderer->ops->draw_wall_run(renderer, vertical ? coord(cross, along) : coord(along, cross), high - low, vertical);
 		}
 	}
+}
+
+// Paints everything the viewport shows from scratch
+// Walls are drawn from their segments, so this takes time for the cells of
+// the viewport and the cells of the snake, but not for the whole board.
+void paint_viewport(GameState *state)
+{
+	renderer->ops->clear_area(renderer);
+
+	// Paint the walls, every segment with a single run
+	for (int i = 0; i < state->walls.count; i++)
+	{
+		paint_wall_segment(state, &state->walls.segments[i]);
+	}
+
+	// Paint the snake from its tail on, every cell is shaped by the steps
+	// into and out of it
+	int count = (state->body_head - state->body_tail + state->body_capacity) % state->body_capacity;
+	Coord previous = cell_coord(state, state->body[state->body_tail]);
+	Direction into = HOLD;
+	for (int i = 0; i < count; i++)
+	{
+		Coord cell = previous;
+		Coord next = cell_coord(state, state->body[(state->body_tail + i + 1) % state->body_capacity]);
+		Direction out = step_direction(state, cell, next);
+		paint_cell(state, cell, body_glyph(out, (into == HOLD) ? out : into));
+		into = out;
+		previous = next;
+	}
+
+	paint_objects(state);
+}
 
+UpdateResult update_state(GameState *state)
+{
 	// Get current input
 	UserInteraction interaction = pop_current_input(state);
 
@@ -952,407 +849,709 @@ UpdateResult update_state(WINDOW *game_win, WINDOW *status_win, GameState *state
 		return QUIT_GAME;
 	}
 
-	// Set direction from input
-	Direction direction_from_input = state->grace_direction == HOLD ? state->direction : state->grace_direction;
-	if (interaction == DIRECTION_LEFT && direction_from_input != RIGHT)
+	// A replay takes its inputs from the recording, otherwise the input
+	// might be recorded
+	if (replay != NULL)
+	{
+		interaction = replay_step(replay, state->ticks, &state->speed_up);
+	}
+	else if (config->autopilot_flag)
 	{
-		direction_from_input = LEFT;
+		interaction = autopilot_move(&autopilot, state);
 	}
-	else if (interaction == DIRECTION_RIGHT && direction_from_input != LEFT)
+	else if (config->bot_flag)
 	{
-		direction_from_input = RIGHT;
+		interaction = bot_move(&bot, state, state->wait_time * NANOSECS_IN_MILLISEC * BOT_TIME_SHARE / 100);
 	}
-	else if (interaction == DIRECTION_UP && direction_from_input != DOWN)
+
+	if (recording != NULL && replay == NULL)
 	{
-		direction_from_input = UP;
+		record_step(recording, state->ticks, interaction, state->speed_up);
 	}
-	else if (interaction == DIRECTION_DOWN && direction_from_input != UP)
+
+	// Advance the round
+	UpdateResult res = step_state(state, interaction);
+
+	// Clear the cell the snake left behind
+	if (state->tail_moved)
 	{
-		direction_from_input = DOWN;
+		paint_cell(state, state->old_tail, GLYPH_EMPTY);
 	}
 
-	// No movement, so no update
-	if (direction_from_input == HOLD)
+	return res;
+}
+
+// Writes the recording of the current round, if it is recorded, and stops recording
+void finish_recording(GameState *state)
+{
+	if (recording == NULL)
+		return;
+
+	bool written = write_recording(recording, config->record_path, state->ticks);
+	free_recording(recording);
+	recording = NULL;
+	if (!written)
 	{
-		return NO_UPDATE;
+		endwin();
+		fprintf(stderr, "Unable to write recording at %s\n", config->record_path);
+		exit(1);
 	}
+}
 
-	// First movement, start the timers if they haven't started yet
-	if (is_timespec_zero(&state->round_timer))
+// Appends the round to the history, replays are not played by the player
+// so they are left out
+void log_round(GameState *state, RoundEnd end)
+{
+	if (replay != NULL || history.fd < 0)
+		return;
+
+	HistoryRecord record;
+	memset(&record, 0, sizeof(HistoryRecord));
+	record.timestamp = time(NULL);
+	record.score = state->points;
+	record.duration = round_time(state);
+	record.ticks = state->ticks;
+	record.frame_p50 = log_percentile(&frame_times, 50);
+	record.frame_p99 = log_percentile(&frame_times, 99);
+	record.length = state->length;
+	record.board_width = state->board_size.x;
+	record.board_height = state->board_size.y;
+	record.flags = (state->rules.open_bounds_flag ? HISTORY_OPEN_BOUNDS : 0) |
+				   (state->rules.wall_flag ? HISTORY_WALLS : 0) |
+				   (config->autopilot_flag ? HISTORY_AUTOPILOT : 0) |
+				   (config->bot_flag ? HISTORY_BOT : 0);
+	// Rounds without walls are recorded with pattern 0
+	record.wall_pattern = state->rules.wall_flag ? state->rules.wall_pattern : 0;
+	record.end = end;
+
+	// Losing a record is not worth interrupting the game
+	append_history(&history, &record);
+}
+
+// Prints how a round without a terminal ended
+// `stopped` describes rounds that were stopped before they ended
+void print_round_result(UpdateResult res, GameState *state, const char *stopped)
+{
+	if (res == GAME_OVER)
+		printf("result: game over\n");
+	else if (res == BOARD_FULL)
+		printf("result: board full\n");
+	else
+		printf("result: %s\n", stopped);
+	printf("score: %lld\n", state->points);
+	printf("length: %d\n", state->length);
+	printf("ticks: %lld\n", state->ticks);
+	printf("seed: %llu\n", (unsigned long long)state->seed);
+}
+
+// Plays one round of the game. Can be interrupted by the user.
+// Returns `true` if a reset was requested, thus another round
+// should start without showing the menu.
+bool play_round(void)
+{
+	// Deactivate timeout for getch
+	if (renderer->interactive)
+		timeout(0);
+
+	// Size of the board: a replay needs the size it was recorded with,
+	// otherwise the board fills the terminal unless a size was given
+	Coord max_coord = renderer->ops->area_size(renderer);
+	if (replay != NULL)
 	{
-		struct timespec now;
-		clock_gettime(CLOCK_REALTIME, &now);
-		state->round_timer = now;
-		state->food_timer = now;
+		max_coord = replay->recording.board_size;
 	}
+	else if (config->board_size.x > 0)
+	{
+		max_coord = config->board_size;
+	}
+
+	// The game area shows as much of the board as fits onto the screen
+	renderer->snake_color = config->snake_color;
+	viewport.size = renderer->ops->begin_round(renderer, max_coord);
 
-	// Init max coordinates in relation to game window
-	Coord max_coord = get_max_coords(game_win);
+	// Every round has its own seed, so it can be replayed
+	uint64_t seed = (replay != NULL) ? replay->recording.seed : next_seed(&round_seeds);
 
-	// Save old coordinates
-	state->old_pos = state->pos;
+	// Init gamestate, the buffers and walls of the last round are reused
+	// so restarting a round doesn't allocate anything
+	// Spectators are not shown the state while it is reset, a restarted
+	// round is reset in place
+	static GameState state;
+	GameRules rules = (replay != NULL) ? replay->recording.rules : rules_from_configuration();
+	broadcast_state = NULL;
+	reset_state(&state, max_coord, &rules, seed);
+	if (config->autopilot_flag)
+		init_autopilot(&autopilot, &state);
+	if (config->bot_flag)
+		clear_bot(&bot);
+
+	// Start recording the round
+	Recording round_recording;
+	if (config->record_path != NULL && replay == NULL)
+	{
+		init_recording(&round_recording, seed, max_coord, &rules);
+		recording = &round_recording;
+	}
+	bool did_loose = false;
+	bool did_win = false;
+	bool should_repeat = false;
+	memset(&frame_times, 0, sizeof(LogHistogram));
 
-	// Update position and check if outer bounds were hit
-	bool wall_hit = update_position(state, direction_from_input, max_coord);
+	// Print status window since points have been set to 0
+	invalidate_status();
+	print_status(&state);
+
+	// Init food coordinates, a board without any free cell is already won
+	did_win = !new_food_coordinates(&state, &state.food_coord);
+
+	// Show the part of the board around the head
+	viewport.origin = coord(0, 0);
+	follow_head(&state);
+	paint_viewport(&state);
+
+	// Spectators start the round from a keyframe, from now on they are shown
+	// this round while the game waits
+	broadcast_round(&broadcast, &state);
+	broadcast_state = &state;
+
+	// Steps are taken at the pace given by the speed of the snake, independent
+	// of rendering. `accumulator` holds the time (in ns) that has passed but has
+	// not been stepped through yet. A frame is rendered whenever something
+	// changed, but at most every TARGET_FRAME_TIME. In between, the loop sleeps
+	// in `wait_for_input` until a key is pressed or the next step or frame is due.
+	long long accumulator = 0;
+	long long last_time = monotonic_ns();
+	long long next_frame = last_time;
+	bool running = !did_win;
+	bool dirty = true;
 
-	// The snake hits something
-	if (wall_hit ||
-		is_on_obstacle(state->head, state->pos.x, state->pos.y) ||
-		is_on_obstacle(state->wall, state->pos.x, state->pos.y))
+	// Game-Loop
+	while (running)
 	{
-		if (state->grace_frames == 0)
+		long long iteration_start = start_phase();
+
+		// Get all pending input
+		long long phase_start = start_phase();
+		if (get_input(&state))
 		{
-			// No grace frames left, game over
-			return GAME_OVER;
+			dirty = true;
 		}
-		else
+		end_phase(PHASE_INPUT, phase_start);
+
+		// Add the time since the last iteration. Besides the end of a rendered
+		// frame, this is the only time the clock is read per iteration: the
+		// round timer and the bonus are derived from the steps taken.
+		long long now = monotonic_ns();
+		long long frame_end = now;
+		accumulator += now - last_time;
+		last_time = now;
+		if (accumulator > MAX_STEP_BACKLOG)
+		{
+			accumulator = MAX_STEP_BACKLOG;
+		}
+
+		// Take all steps that are due, these might be several per frame
+		while (running && accumulator >= step_interval(&state))
 		{
-			// We still have grace frames so we reset the coordinate and
-			// let the player change the direction
-			state->grace_frames--;
-			state->pos = state->old_pos;
+			accumulator -= step_interval(&state);
+
+			// Update game state
+			phase_start = start_phase();
+			UpdateResult res = update_state(&state);
+			broadcast_step(&broadcast, &state);
+			end_phase(PHASE_UPDATE, phase_start);
+			dirty = true;
+
+			// Paint snake head and food, or everything if the viewport had to
+			// move along with the head
+			phase_start = start_phase();
+			if (follow_head(&state))
+			{
+				paint_viewport(&state);
+			}
+			else
+			{
+				paint_objects(&state);
+			}
+			end_phase(PHASE_PAINT, phase_start);
 
-			state->grace_direction = direction_from_input;
+			if (res == GAME_OVER)
+			{
+				did_loose = true;
+				running = false;
+			}
+			else if (res == BOARD_FULL)
+			{
+				did_win = true;
+				running = false;
+			}
+			else if (res == PAUSE_GAME)
+			{
+				renderer->ops->present(renderer);
+				pause_game("--- PAUSED ---", TONE_NEUTRAL, 0);
+
+				// Time spent paused is not stepped through, so neither the
+				// round timer nor the bonus decay count it. Neither do the
+				// times of the frame and the iteration.
+				accumulator = 0;
+				last_time = monotonic_ns();
+				now = last_time;
+				frame_end = last_time;
+				iteration_start = start_phase();
+			}
+			else if (res == RESTART_GAME)
+			{
+				should_repeat = true;
+				running = false;
+			}
+			else if (res == QUIT_GAME)
+			{
+				finish_recording(&state);
+				log_round(&state, END_QUIT);
+				broadcast_end(&broadcast, END_QUIT);
+				clean_exit(0);
+			}
 
-			return GRACE;
+			// A replay ends after as many steps as the recorded round took,
+			// a round nobody watches after at most `max_ticks` steps
+			if (replay != NULL && state.ticks >= replay->recording.final_tick)
+			{
+				running = false;
+			}
+			else if (!renderer->interactive && state.ticks >= config->max_ticks)
+			{
+				running = false;
+			}
 		}
-	}
 
-	// Reset grace frames and direction
-	state->grace_frames = GRACE_FRAMES;
-	state->grace_direction = HOLD;
+		// Send the steps to the spectators, at most once per iteration
+		serve_broadcast(&broadcast, &state);
 
-	// Update directions
-	state->old_direction = state->direction;
-	state->direction = direction_from_input;
+		// Render a frame if something changed and the frame is due
+		if (running && dirty && now >= next_frame)
+		{
+			// Update status window, or show the performance HUD in its place
+			phase_start = start_phase();
+			if (perf_hud_visible)
+			{
+				print_perf_hud();
+			}
+			else
+			{
+				print_status(&state);
+			}
+			end_phase(PHASE_STATUS, phase_start);
 
-	// Add new head to snake
-	LinkedCell *new_cell = malloc(sizeof(LinkedCell));
-	new_cell->coord = state->pos;
-	new_cell->prev = state->head;
-	state->head->next = new_cell;
-	state->head = new_cell;
+			// Put game area and status bar on the screen at once
+			phase_start = start_phase();
+			renderer->ops->present(renderer);
+			end_phase(PHASE_REFRESH, phase_start);
 
-	// Head hits the food
-	if ((state->pos.x == state->food_coord.x) &&
-		(state->pos.y == state->food_coord.y))
-	{
-		// Calculate bonus based on elapsed time since food was spawned
-		int current_bonus = calculate_current_bonus(&state->food_timer);
-		// Let the snake grow and change the speed
-		state->growing +=
-			state->superfood_counter == 0 ? SUPERFOOD_GROW_FACTOR : GROW_FACTOR;
-		if (state->wait_time > MINIMUM_WAIT_TIME)
+			frame_end = monotonic_ns();
+			add_log_sample(&frame_times, frame_end - now);
+			if (perf_enabled)
+			{
+				record_frame(&perf_stats, frame_end - iteration_start, TARGET_FRAME_TIME);
+			}
+
+			// The next frame may be rendered one frame time from now
+			next_frame = now + TARGET_FRAME_TIME;
+			dirty = false;
+		}
+
+		if (!running)
+		{
+			break;
+		}
+
+		// While the snake has not started moving, no step can change anything
+		// until the user presses a key, so we sleep without a timeout
+		bool idle = state.direction == HOLD && state.grace_direction == HOLD &&
+					state.input_queue.count == 0 && replay == NULL && !config->autopilot_flag &&
+					!config->bot_flag;
+		// Only the waits bounded by the next step or frame are timed, this one
+		// lasts as long as the user likes
+		if (idle && !dirty)
 		{
-			state->wait_time -= WAIT_TIME_DECREMENT;
+			wait_for_input(-1);
+
+			// Take the first step right after the key press
+			last_time = monotonic_ns();
+			accumulator = step_interval(&state);
+			continue;
 		}
-		state->points +=
-			(current_bonus +
-			 state->length + (STARTING_WAIT_TIME - state->wait_time) * 5) *
-			(state->superfood_counter == 0 ? 5 : 1);
-		state->superfood_counter =
-			(state->superfood_counter == 0) ? SUPERFOOD_COUNTER_VALUE : state->superfood_counter - 1;
 
-		// Spawn new food
-		new_random_coordinates(state->head, state->wall, &state->food_coord, max_coord);
+		// Sleep until the next step (or the pending frame) is due or a key is pressed
+		long long wake_time = idle ? next_frame : last_time + step_interval(&state) - accumulator;
+		if (dirty && next_frame < wake_time)
+		{
+			wake_time = next_frame;
+		}
+		phase_start = start_phase();
+		wait_for_input(wake_time - frame_end);
+		end_phase(PHASE_WAIT, phase_start);
+	}
+
+	// Save the recording of the round
+	RoundEnd end = did_loose ? END_GAME_OVER : (did_win ? END_BOARD_FULL : END_RESTART);
+	finish_recording(&state);
+	log_round(&state, end);
+	broadcast_end(&broadcast, end);
 
-		// Record when this food was spawned for bonus decay calculation
-		clock_gettime(CLOCK_REALTIME, &state->food_timer);
+	// Set a new highscore (replays are not played by the player)
+	uint32_t key = score_key(&state.rules, state.board_size);
+	if (state.points > get_highscore(&config->scores, key) && replay == NULL &&
+		set_highscore(&config->scores, key, state.points))
+	{
+		// Write highscores to local file, the game doesn't wait for the disk
+		save_scores(&score_writer, &config->scores);
+		pause_game("--- NEW HIGHSCORE ---", TONE_GOOD, 2);
 	}
 
-	// If the snake is not growing...
-	if (state->growing == 0)
+	if (did_loose)
 	{
-		// Clear last cell
-		wattrset(game_win, A_NORMAL);
-		mvwaddch(game_win, state->last->coord.y, state->last->coord.x, ' ');
-		// ...free the memory for this cell
-		LinkedCell *new_last;
-		state->last->next->prev = NULL;
-		new_last = state->last->next;
-		free(state->last);
-		state->last = new_last;
+		pause_game("--- GAME OVER ---", TONE_BAD, 2);
 	}
-	else
+	else if (did_win)
 	{
-		// If the snake is growing and moving, just decrement 'growing'...
-		state->growing--;
-		// ...and increment 'length'
-		state->length++;
+		pause_game("--- YOU WIN ---", TONE_GOOD, 2);
 	}
 
-	return CONTINUE;
-}
+	renderer->ops->end_round(renderer);
 
-LinkedCell *init_wall(Coord max_coord)
-{
-	int max_x = max_coord.x;
-	int max_y = max_coord.y;
-	// Creating walls (all walls are referenced by one pointer)
-	LinkedCell *wall = NULL;
-	if (config->wall_flag)
+	// Without a terminal the result is printed instead
+	if (!renderer->interactive)
 	{
-		switch (config->wall_pattern)
-		{
-		case 1:
-			wall = create_wall(0, max_y / 4, max_x / 2, DOWN, NULL);
-			wall = create_wall(max_y, 3 * max_y / 4, max_x / 2, UP, wall);
-			wall = create_wall(0, max_x / 4, max_y / 2, RIGHT, wall);
-			wall = create_wall(max_x, 3 * max_x / 4, max_y / 2, LEFT, wall);
-			break;
-		case 2:
-			wall = create_wall(max_y / 4, 3 * max_y / 4, max_x / 4, DOWN, NULL);
-			wall = create_wall(max_y / 4, 3 * max_y / 4, 3 * max_x / 4, DOWN, wall);
-			break;
-		case 3:
-			wall = create_wall(max_x / 4, 3 * max_x / 4, max_y / 4, RIGHT, NULL);
-			wall = create_wall(max_x / 4, 3 * max_x / 4, 3 * max_y / 4, RIGHT, wall);
-			break;
-		case 4:
-			wall = create_wall(max_y / 2 + 2, 3 * max_y / 4, max_x / 4, DOWN, NULL);
-			wall = create_wall(max_y / 4, max_y / 2 - 1, max_x / 4, DOWN, wall);
-			wall = create_wall(max_y / 2 + 2, 3 * max_y / 4, 3 * max_x / 4, DOWN, wall);
-			wall = create_wall(max_y / 4, max_y / 2 - 1, 3 * max_x / 4, DOWN, wall);
-			wall = create_wall(max_x / 4, max_x / 2 - 1, max_y / 4, RIGHT, wall);
-			wall = create_wall(max_x / 4, max_x / 2 - 1, 3 * max_y / 4, RIGHT, wall);
-			wall = create_wall(max_x / 2 + 2, 3 * max_x / 4, max_y / 4, RIGHT, wall);
-			wall = create_wall(max_x / 2 + 2, 3 * max_x / 4 + 1, 3 * max_y / 4, RIGHT, wall);
-			break;
-		case 5:
-			wall = create_wall(0, max_y / 4, max_x / 4, DOWN, NULL);
-			wall = create_wall(0, max_y / 4, 3 * max_x / 4, DOWN, wall);
-			wall = create_wall(0, max_y / 4, max_x / 2, DOWN, wall);
-			wall = create_wall(max_y, 3 * max_y / 4, max_x / 4, UP, wall);
-			wall = create_wall(max_y, 3 * max_y / 4, 3 * max_x / 4, UP, wall);
-			wall = create_wall(max_y, 3 * max_y / 4, max_x / 2, UP, wall);
-			wall = create_wall(0, max_x / 4, max_y / 2, RIGHT, wall);
-			wall = create_wall(max_x, 3 * max_x / 4, max_y / 2, LEFT, wall);
-			break;
-		default:
-			fprintf(stderr, "Illegal wall pattern: %d\n", config->wall_pattern);
-			abort();
-		}
+		print_round_result(did_loose ? GAME_OVER : (did_win ? BOARD_FULL : CONTINUE), &state,
+						   (replay != NULL) ? "end of recording" : "tick limit");
+		char p50_buf[16], p99_buf[16];
+		format_duration(p50_buf, sizeof(p50_buf), log_percentile(&frame_times, 50));
+		format_duration(p99_buf, sizeof(p99_buf), log_percentile(&frame_times, 99));
+		printf("frame time p50: %s\nframe time p99: %s\n", p50_buf, p99_buf);
 	}
-	return wall;
+
+	return should_repeat;
 }
 
-GameState init_state(Coord max_coord)
+void play_game(void)
 {
-	// Init gamestate
-	GameState state;
-	state.points = 0;
-	state.direction = HOLD;
-	state.old_direction = HOLD;
-	state.grace_direction = HOLD;
-	state.wait_time = STARTING_WAIT_TIME;
-	state.pos.x = max_coord.x / 2;
-	state.pos.y = max_coord.y / 2;
-	state.old_pos = state.pos;
-	state.points_counter = POINTS_COUNTER_VALUE;
-	state.length = 1;
-	state.growing = STARTING_LENGTH - 1;
-	state.grace_frames = GRACE_FRAMES;
-	state.superfood_counter = SUPERFOOD_COUNTER_VALUE;
-	state.food_coord.x = 0;
-	state.food_coord.y = 0;
-	state.frame_delay = 0;
-	state.input_queue = NULL;
-	state.speed_up = false;
-	set_timespec_zero(&state.round_timer);
-	set_timespec_zero(&state.food_timer);
-
-	// Create first cell for the snake
-	LinkedCell *head = malloc(sizeof(LinkedCell));
-	head->coord = state.pos;
-	head->prev = NULL;
-	head->next = NULL;
-	state.head = head;
-	state.last = head;
-
-	// Init wall
-	state.wall = init_wall(max_coord);
-
-	return state;
+	while (true)
+	{
+		bool should_repeat = play_round();
+		if (!should_repeat)
+			return;
+	}
 }
 
-// Plays one round of the game. Can be interrupted by the user.
-// Returns `true` if a reset was requested, thus another round
-// should start without showing the menu.
-bool play_round(void)
+// Shows the rounds another game broadcasts, as they are played, until the
+// broadcast ends or the user presses Shift+Q
+void watch_broadcast(Spectator *spectator)
 {
-	// Deactivate timeout for getch
+	// The round is mirrored in a state of its own, which is only changed by
+	// the messages of the broadcast
+	static GameState state;
+	Coord board_size = coord(0, 0);
+	bool in_round = false;
+	bool showing_end = false;
 	timeout(0);
 
-	// Init max coordinates
-	int global_max_x = getmaxx(stdscr);
-	int global_max_y = getmaxy(stdscr);
-
-	// Clear screen
-	clear();
-	refresh();
-
-	// Create subwindows
-	WINDOW *game_win = subwin(stdscr, global_max_y - 4, global_max_x, 0, 0);
-	WINDOW *status_win = subwin(stdscr, 4, global_max_x, global_max_y - 4, 0);
-
-	// Init max coordinates in relation to game window
-	Coord max_coord = get_max_coords(game_win);
-
-	// Init gamestate
-	GameState state = init_state(max_coord);
-	bool did_loose = false;
-	bool should_repeat = false;
-
-	// Print status window since points have been set to 0
-	print_status(status_win, &state, NULL);
-
-	if (state.wall != NULL)
-	{
-		// Paint the wall
-		// It should never be overwritten, since it will not be redrawn
-		LinkedCell *tmp_cell1, *tmp_cell2;
-		tmp_cell2 = state.wall;
-		wattrset(game_win, COLOR_PAIR(5) | A_BOLD);
-		do
-		{
-			tmp_cell1 = tmp_cell2;
-			mvwaddch(game_win, tmp_cell1->coord.y, tmp_cell1->coord.x, ACS_CKBOARD);
-			tmp_cell2 = tmp_cell1->prev;
-		} while (tmp_cell2 != NULL);
-	}
-
-	// Init food coordinates
-	new_random_coordinates(state.head, state.wall, &state.food_coord, max_coord);
+	struct pollfd sources[2];
+	sources[0].fd = STDIN_FILENO;
+	sources[0].events = POLLIN;
+	sources[1].fd = spectator->fd;
+	sources[1].events = POLLIN;
 
-	// Game-Loop
 	while (true)
 	{
-		// Start timer
-		struct timespec start_timer, end_timer, current_time, elapsed;
-		clock_gettime(CLOCK_REALTIME, &start_timer);
+		poll(sources, 2, -1);
 
-		// Calculate elapsed time for timer display (only if timer has started)
-		bool timer_started = !is_timespec_zero(&state.round_timer);
-		if (timer_started)
+		int key;
+		while ((key = getch()) != ERR)
+		{
+			if (key == 'Q')
+			{
+				close_spectator(spectator);
+				return;
+			}
+		}
+		if (sources[1].revents == 0)
 		{
-			clock_gettime(CLOCK_REALTIME, &current_time);
-			elapsed = subtract_timespec(&current_time, &state.round_timer);
+			continue;
 		}
 
-		// Paint snake head and food
-		paint_objects(game_win, &state);
-
-		// Update status window
-		print_status(status_win, &state, timer_started ? &elapsed : NULL);
-
-		// Refresh game window
-		wrefresh(game_win);
-
-		// Get input
-		get_input(&state);
-
-		// Update game state
-		UpdateResult res = update_state(game_win, status_win, &state);
-		if (res == GAME_OVER)
+		if (!receive_broadcast(spectator))
 		{
-			did_loose = true;
+			if (in_round)
+				pause_game("--- BROADCAST ENDED ---", TONE_NEUTRAL, 2);
 			break;
 		}
-		else if (res == PAUSE_GAME)
-		{
-			wattrset(status_win, COLOR_PAIR(4) | A_BOLD);
 
-			// Record when the pause starts so we can calculate pause duration
-			struct timespec pause_start_time;
-			clock_gettime(CLOCK_REALTIME, &pause_start_time);
+		// Apply everything received, but draw a single frame for it
+		BroadcastMessage message;
+		RoundEnd end;
+		bool dirty = false;
+		while ((message = apply_broadcast(spectator, &state, &end)) != BROADCAST_NONE)
+		{
+			if (message == BROADCAST_INVALID)
+			{
+				endwin();
+				fprintf(stderr, "Unable to read the broadcast at %s\n", config->watch_path);
+				exit(1);
+			}
+			else if (message == BROADCAST_KEYFRAME)
+			{
+				// A keyframe within a round on a board of the same size is drawn
+				// over the last one, otherwise a new round starts on the screen
+				if (!in_round || showing_end || board_size.x != state.board_size.x ||
+					board_size.y != state.board_size.y)
+				{
+					if (in_round)
+						renderer->ops->end_round(renderer);
+					renderer->snake_color = config->snake_color;
+					viewport.size = renderer->ops->begin_round(renderer, state.board_size);
+					board_size = state.board_size;
+				}
+				viewport.origin = coord(0, 0);
+				follow_head(&state);
+				paint_viewport(&state);
+				invalidate_status();
+				in_round = true;
+				showing_end = false;
+			}
+			else if (message == BROADCAST_DELTA)
+			{
+				if (state.tail_moved)
+				{
+					paint_cell(&state, state.old_tail, GLYPH_EMPTY);
+				}
+				if (follow_head(&state))
+				{
+					paint_viewport(&state);
+				}
+				else
+				{
+					paint_objects(&state);
+				}
+			}
+			else if (message == BROADCAST_END && in_round)
+			{
+				// The message stays until the next round starts
+				renderer->ops->present(renderer);
+				if (end == END_GAME_OVER)
+					renderer->ops->show_message(renderer, "--- GAME OVER ---", TONE_BAD);
+				else if (end == END_BOARD_FULL)
+					renderer->ops->show_message(renderer, "--- YOU WIN ---", TONE_GOOD);
+				else
+					renderer->ops->show_message(renderer, "--- ROUND ENDED ---", TONE_NEUTRAL);
+				invalidate_status();
+				showing_end = true;
+			}
+			dirty = true;
+		}
 
-			// Do the actual pause
-			pause_game(status_win, "--- PAUSED ---", 0);
+		if (dirty && in_round && !showing_end)
+		{
+			print_status(&state);
+			renderer->ops->present(renderer);
+		}
+	}
+	close_spectator(spectator);
+}
 
-			// Record time when game was resumed
-			struct timespec resume_time;
-			clock_gettime(CLOCK_REALTIME, &resume_time);
+// Reads the input script for headless rounds from `path` ("-" for stdin)
+// Every character is one step: U, D, L and R for a direction, '.' for no input
+// Whitespace is ignored. Returns `NULL` on error.
+char *read_script(const char *path)
+{
+	FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+	if (file == NULL)
+	{
+		return NULL;
+	}
 
-			// Calculate duration of pause
-			struct timespec pause_duration = subtract_timespec(&resume_time, &pause_start_time);
+	size_t length = 0, capacity = 256;
+	char *script = malloc(capacity);
+	int c;
+	while ((c = fgetc(file)) != EOF)
+	{
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+			continue;
 
-			// Adjust both timers forward by pause duration so displayed time
-			// and bonus decay do not include time spent paused
-			add_timespec(&state.round_timer, &pause_duration);
-			add_timespec(&state.food_timer, &pause_duration);
-		}
-		else if (res == RESTART_GAME)
+		if (strchr("UDLRudlr.", c) == NULL)
 		{
-			should_repeat = true;
+			free(script);
+			script = NULL;
 			break;
 		}
-		else if (res == QUIT_GAME)
+
+		if (length + 1 == capacity)
 		{
-			clean_exit(0);
+			capacity *= 2;
+			script = realloc(script, capacity);
 		}
+		script[length++] = c;
+	}
+
+	if (script != NULL)
+		script[length] = '\0';
+
+	if (file != stdin)
+		fclose(file);
+	return script;
+}
+
+UserInteraction interaction_from_script(char c)
+{
+	switch (c)
+	{
+	case 'U':
+	case 'u':
+		return DIRECTION_UP;
+	case 'D':
+	case 'd':
+		return DIRECTION_DOWN;
+	case 'L':
+	case 'l':
+		return DIRECTION_LEFT;
+	case 'R':
+	case 'r':
+		return DIRECTION_RIGHT;
+	default:
+		return NO_INPUT;
+	}
+}
 
-		// End timer
-		clock_gettime(CLOCK_REALTIME, &end_timer);
+// Plays the replay as fast as possible without a terminal and prints the result
+void play_replay_unthrottled(void)
+{
+	Recording *recorded = &replay->recording;
+	GameState state = init_state(recorded->board_size, &recorded->rules, recorded->seed);
+	UpdateResult res = CONTINUE;
 
-		// Delay game loop to achieve target frame rate
-		delay_frame(&start_timer, &end_timer);
+	// Init food coordinates, a board without any free cell is already won
+	if (!new_food_coordinates(&state, &state.food_coord))
+	{
+		res = BOARD_FULL;
 	}
 
-	// Set a new highscore
-	if (state.points > config->highscore)
+	while (res != GAME_OVER && res != BOARD_FULL && state.ticks < recorded->final_tick)
 	{
-		// Remember the highscore
-		config->highscore = state.points;
+		res = step_state(&state, replay_step(replay, state.ticks, &state.speed_up));
+	}
 
-		// Write highscore to local file
-		if (write_score_file(state.points))
-		{
-			wattrset(status_win, COLOR_PAIR(2) | A_BOLD);
-			pause_game(status_win, "--- NEW HIGHSCORE ---", 2);
-		}
-		else
+	print_round_result(res, &state, "end of recording");
+	free_state(&state);
+}
+
+// Plays one round without a terminal, driven by the input script which is
+// repeated until the round ends or `max_ticks` steps were taken.
+// Steps are taken as fast as possible and the result is printed to stdout.
+void play_headless(void)
+{
+	char *script = "";
+	if (config->script_path != NULL)
+	{
+		script = read_script(config->script_path);
+		if (script == NULL)
 		{
-			endwin();
-			fprintf(stderr, "Unable to write savefile at %s\n", config->save_file_path);
-			fprintf(stderr, "Final highscore was: %lld\n", state.points);
+			fprintf(stderr, "Unable to read input script at %s\n", config->script_path);
 			exit(1);
 		}
 	}
+	size_t script_length = strlen(script), script_pos = 0;
 
-	if (did_loose)
+	// Init gamestate
+	GameRules rules = rules_from_configuration();
+	GameState state = init_state(config->headless_size, &rules, next_seed(&round_seeds));
+	if (config->autopilot_flag)
+		init_autopilot(&autopilot, &state);
+	if (config->bot_flag)
+		clear_bot(&bot);
+	UpdateResult res = CONTINUE;
+
+	// Init food coordinates, a board without any free cell is already won
+	if (!new_food_coordinates(&state, &state.food_coord))
 	{
-		wattrset(status_win, COLOR_PAIR(3) | A_BOLD);
-		pause_game(status_win, "--- GAME OVER ---", 2);
+		res = BOARD_FULL;
 	}
 
-	// Freeing memory used for the snake
-	free_linked_list(state.head);
-
-	// Freeing memory used for the walls
-	free_linked_list(state.wall);
-
-	// Free remaining input queue
-	free_queue(state.input_queue);
+	while (res != GAME_OVER && res != BOARD_FULL && state.ticks < config->max_ticks)
+	{
+		// Feed the next input of the script through the input queue
+		if (config->autopilot_flag)
+		{
+			push_input(autopilot_move(&autopilot, &state), &state);
+		}
+		else if (config->bot_flag)
+		{
+			push_input(bot_move(&bot, &state, 0), &state);
+		}
+		else if (script_length > 0)
+		{
+			push_input(interaction_from_script(script[script_pos]), &state);
+			script_pos = (script_pos + 1) % script_length;
+		}
 
-	// Delete windows
-	delwin(game_win);
-	delwin(status_win);
+		res = step_state(&state, pop_current_input(&state));
+	}
 
-	// Delete the screen content
-	clear();
-	refresh();
+	print_round_result(res, &state, "tick limit");
 
-	return should_repeat;
+	free_state(&state);
+	if (config->script_path != NULL)
+		free(script);
 }
 
-void play_game(void)
+// Plays `batch_rounds` headless rounds on `batch_threads` threads, all driven
+// by the input script or by random inputs if there is none, and prints how
+// they went
+void play_batch(void)
 {
-	while (true)
+	BatchConfig batch;
+	batch.board_size = config->headless_size;
+	batch.rules = rules_from_configuration();
+	batch.script = NULL;
+	batch.script_length = 0;
+	batch.max_ticks = config->max_ticks;
+	batch.seed = next_seed(&round_seeds);
+	batch.rounds = config->batch_rounds;
+	batch.threads = config->batch_threads;
+	batch.autopilot = config->autopilot_flag;
+	batch.bot = config->bot_flag;
+
+	UserInteraction *script = NULL;
+	if (config->script_path != NULL)
+	{
+		char *text = read_script(config->script_path);
+		if (text == NULL)
+		{
+			fprintf(stderr, "Unable to read input script at %s\n", config->script_path);
+			exit(1);
+		}
+
+		// Scripts without any step play random inputs
+		batch.script_length = strlen(text);
+		if (batch.script_length > 0)
+		{
+			script = malloc(batch.script_length * sizeof(UserInteraction));
+			for (size_t i = 0; i < batch.script_length; i++)
+				script[i] = interaction_from_script(text[i]);
+			batch.script = script;
+		}
+		free(text);
+	}
+
+	BatchResult result;
+	if (!run_batch(&batch, &result))
 	{
-		bool should_repeat = play_round();
-		if (!should_repeat)
-			return;
+		fprintf(stderr, "Unable to allocate memory for %lld rounds\n", batch.rounds);
+		exit(1);
 	}
+	print_batch_result(&batch, &result, stdout);
+	printf("seed: %llu\n", (unsigned long long)batch.seed);
+
+	free_batch_result(&result);
+	free(script);
 }
 
 void show_options(WINDOW *options_win)
@@ -1389,7 +1588,7 @@ option_show:
 	wrefresh(options_win);
 
 	// Wait for input
-	int key = getch();
+	int key = wait_for_key();
 	if (key == config->up_key)
 	{
 		if (index == 0)
@@ -1436,9 +1635,6 @@ GameConfiguration show_startscreen(void)
 	int i, index = 0;
 	char txt_buf[40];
 show:
-	// Set getch to blocking mode
-	timeout(-1);
-
 	// Clear the whole screen
 	clear();
 
@@ -1476,7 +1672,7 @@ show:
 	print_centered(stdscr, max_y - 1, txt_buf);
 
 	// Wait for input
-	int key = getch();
+	int key = wait_for_key();
 	if (key == config->up_key)
 	{
 		if (index == 0)
@@ -1504,7 +1700,7 @@ show:
 			print_centered(options_win, 2, "Start with -v to get information on the license");
 			print_centered(options_win, 3, "Press any key!");
 			wrefresh(options_win);
-			getch();
+			wait_for_key();
 			break;
 		case 3:
 			clean_exit(0);
@@ -1518,12 +1714,44 @@ show:
 	goto show;
 }
 
+// Reads a board size given as `<width>x<height>` into `size`
+// Returns `false` if it is no valid board size, `true` otherwise
+bool parse_size(const char *text, Coord *size)
+{
+	return sscanf(text, "%dx%d", &size->x, &size->y) == 2 &&
+		   in_range(size->x, 1, MAX_BOARD_SIZE) && in_range(size->y, 1, MAX_BOARD_SIZE);
+}
+
 void parse_arguments(int argc, char **argv)
 {
 	int arg, int_arg;
 	int vim_flag = false;
 	int option_index = 0;
 	char *string_arg;
+	long long long_arg;
+	Coord size_arg;
+
+	// Values for options that only have a long form
+	enum
+	{
+		HEADLESS_OPT = 256,
+		SCRIPT_OPT,
+		TICKS_OPT,
+		RECORD_OPT,
+		REPLAY_OPT,
+		MAX_SPEED_OPT,
+		SEED_OPT,
+		PERF_HUD_OPT,
+		BATCH_OPT,
+		THREADS_OPT,
+		AUTOPILOT_OPT,
+		BOT_OPT,
+		BOARD_OPT,
+		STATS_OPT,
+		RENDERER_OPT,
+		BROADCAST_OPT,
+		WATCH_OPT
+	};
 
 	const struct option long_opts[] =
 		{
@@ -1536,7 +1764,25 @@ void parse_arguments(int argc, char **argv)
 			{"vim", no_argument, &vim_flag, true},
 			{"color", required_argument, NULL, 'c'},
 			{"walls", required_argument, NULL, 'w'},
-			{"filepath", required_argument, NULL, 'f'}};
+			{"filepath", required_argument, NULL, 'f'},
+			{"headless", required_argument, NULL, HEADLESS_OPT},
+			{"script", required_argument, NULL, SCRIPT_OPT},
+			{"ticks", required_argument, NULL, TICKS_OPT},
+			{"record", required_argument, NULL, RECORD_OPT},
+			{"replay", required_argument, NULL, REPLAY_OPT},
+			{"max-speed", no_argument, NULL, MAX_SPEED_OPT},
+			{"seed", required_argument, NULL, SEED_OPT},
+			{"perf-hud", no_argument, NULL, PERF_HUD_OPT},
+			{"batch", required_argument, NULL, BATCH_OPT},
+			{"threads", required_argument, NULL, THREADS_OPT},
+			{"autopilot", no_argument, NULL, AUTOPILOT_OPT},
+			{"bot", no_argument, NULL, BOT_OPT},
+			{"board", required_argument, NULL, BOARD_OPT},
+			{"stats", no_argument, NULL, STATS_OPT},
+			{"renderer", required_argument, NULL, RENDERER_OPT},
+			{"broadcast", required_argument, NULL, BROADCAST_OPT},
+			{"watch", required_argument, NULL, WATCH_OPT},
+			{NULL, 0, NULL, 0}};
 
 	while ((arg = getopt_long(argc, argv, "osif:rw:c:hv", long_opts, &option_index)) != -1)
 	{
@@ -1572,6 +1818,99 @@ void parse_arguments(int argc, char **argv)
 				break;
 			}
 			goto help_text;
+		case HEADLESS_OPT:
+			if (parse_size(optarg, &size_arg))
+			{
+				config->headless_flag = true;
+				config->headless_size = size_arg;
+				break;
+			}
+			goto help_text;
+		case BOARD_OPT:
+			if (parse_size(optarg, &size_arg))
+			{
+				config->board_size = size_arg;
+				break;
+			}
+			goto help_text;
+		case SCRIPT_OPT:
+			config->script_path = optarg;
+			break;
+		case RECORD_OPT:
+			config->record_path = optarg;
+			break;
+		case BROADCAST_OPT:
+			config->broadcast_path = optarg;
+			break;
+		case WATCH_OPT:
+			config->watch_path = optarg;
+			break;
+		case REPLAY_OPT:
+			config->replay_path = optarg;
+			break;
+		case MAX_SPEED_OPT:
+			config->max_speed_flag = true;
+			break;
+		case PERF_HUD_OPT:
+			config->perf_hud_flag = true;
+			break;
+		case SEED_OPT:
+			config->seed = strtoull(optarg, &string_arg, 10);
+			if (*optarg != '\0' && *string_arg == '\0')
+			{
+				break;
+			}
+			goto help_text;
+		case TICKS_OPT:
+			long_arg = atoll(optarg);
+			if (long_arg > 0)
+			{
+				config->max_ticks = long_arg;
+				break;
+			}
+			goto help_text;
+		case AUTOPILOT_OPT:
+			config->autopilot_flag = true;
+			break;
+		case BOT_OPT:
+			config->bot_flag = true;
+			break;
+		case STATS_OPT:
+			config->stats_flag = true;
+			break;
+		case RENDERER_OPT:
+			if (strcmp(optarg, "curses") == 0)
+			{
+				config->renderer_kind = RENDERER_CURSES;
+				break;
+			}
+			else if (strcmp(optarg, "ansi") == 0)
+			{
+				config->renderer_kind = RENDERER_ANSI;
+				break;
+			}
+			else if (strcmp(optarg, "null") == 0)
+			{
+				config->renderer_kind = RENDERER_NULL;
+				break;
+			}
+			goto help_text;
+		case BATCH_OPT:
+			long_arg = atoll(optarg);
+			if (long_arg > 0)
+			{
+				config->batch_rounds = long_arg;
+				break;
+			}
+			goto help_text;
+		case THREADS_OPT:
+			int_arg = atoi(optarg);
+			if (in_range(int_arg, 1, 1024))
+			{
+				config->batch_threads = int_arg;
+				break;
+			}
+			goto help_text;
 		case 'c':
 			int_arg = atoi(optarg);
 			if (in_range(int_arg, 1, 5))
@@ -1593,6 +1932,23 @@ void parse_arguments(int argc, char **argv)
 			printf(" --ignore-savefile, -i\n\tIgnore savefile (don't read nor write)\n");
 			printf(" --filepath path, -f path\n\tSpecify alternate path savefile\n");
 			printf(" --vim\n\tUse vim-style direction controls (H,J,K,L)\n");
+			printf(" --board <width>x<height>\n\tPlay on a board of the given size (up to %dx%d), the view follows the snake\n", MAX_BOARD_SIZE, MAX_BOARD_SIZE);
+			printf(" --headless <width>x<height>\n\tSimulate a round on a board of the given size without a terminal\n");
+			printf(" --script path\n\tInput script for headless rounds (U,D,L,R or '.' per step, - for stdin)\n");
+			printf(" --ticks <n>\n\tMaximum amount of steps for headless rounds (default: %d)\n", DEFAULT_HEADLESS_TICKS);
+			printf(" --autopilot\n\tLet the computer play (also for headless and batch rounds)\n");
+			printf(" --bot\n\tLet a computer player play that searches several steps ahead on all threads\n");
+			printf(" --batch <n>\n\tPlay n headless rounds (random inputs without --script) and print statistics\n");
+			printf(" --threads <n>\n\tThreads to play batch rounds or to search with --bot on (default: amount of cores)\n");
+			printf(" --record path\n\tRecord every round to path (the file holds the last round played)\n");
+			printf(" --replay path\n\tReplay a recorded round\n");
+			printf(" --max-speed\n\tReplay as fast as possible without rendering and print the result\n");
+			printf(" --seed <n>\n\tSeed for the random numbers of all rounds (default: current time)\n");
+			printf(" --stats\n\tPrint statistics of all rounds played (kept next to the savefile) and quit\n");
+			printf(" --renderer <curses|ansi|null>\n\tDraw rounds with ncurses (default), with escape sequences for the changed\n\tcells written at once, or discard the output: null plays one round\n\tof --autopilot, --bot or --replay in real time without a terminal and prints the result\n");
+			printf(" --broadcast path\n\tStream every round to spectators connecting to the socket at path\n");
+			printf(" --watch path\n\tWatch the rounds of a game broadcasting at path (Shift+Q to stop)\n");
+			printf(" --perf-hud\n\tShow timings of the game loop and print their histograms on exit\n");
 			printf(" --help, -h\n\tDisplay this information\n");
 			printf(" --version, -v\n\tDisplay version and license information\n\n");
 			printf("In-game Controls:\n");
@@ -1600,6 +1956,7 @@ void parse_arguments(int argc, char **argv)
 			printf(" Enter\n\tPause\n");
 			printf(" Shift+Q\n\tEnd Round\n");
 			printf(" Shift+R\n\tRestart Round (can be used to resize the game after window size has changed)\n");
+			printf(" Shift+P\n\tShow/hide timings of the game loop\n");
 			exit(0);
 		case 'v':
 			printf("C-Snake %s\nCopyright (c) 2015-%s Philipp Hagenlocher\nLicense: MIT\nCheck source for full license text.\nThere is no warranty.\n", VERSION, CC_END_YEAR);
@@ -1625,15 +1982,129 @@ int main(int argc, char **argv)
 	// Parse arguments
 	parse_arguments(argc, argv);
 
-	// Seed RNG with current time
-	srand(time(NULL));
+	// Seed the generator for the seeds of the rounds
+	seed_rng(&round_seeds, config->seed);
+
+	// The bot copies the whole board, so it can't play on huge boards
+	Coord board_size = config->headless_flag ? config->headless_size : config->board_size;
+	if (config->bot_flag && (long long)board_size.x * board_size.y > DENSE_AREA_LIMIT)
+	{
+		fprintf(stderr, "The bot can't play on boards of more than %d cells\n", DENSE_AREA_LIMIT);
+		exit(1);
+	}
+
+	// The bot searches on as many threads as batch rounds are played on,
+	// batch rounds start a bot of their own on every thread
+	if (config->bot_flag && config->batch_rounds == 0 && !init_bot(&bot, config->batch_threads))
+	{
+		fprintf(stderr, "Unable to start the bot\n");
+		exit(1);
+	}
+
+	// Print the statistics of the round history
+	if (config->stats_flag)
+	{
+		char *path = history_file_path();
+		if (path == NULL || !print_history_stats(path, stdout))
+		{
+			fprintf(stderr, "Unable to read the round history at %s\n", path != NULL ? path : "(unknown)");
+			exit(1);
+		}
+		free(path);
+		exit(0);
+	}
+
+	// Headless rounds neither use the terminal nor the savefile
+	if (config->headless_flag)
+	{
+		if (config->batch_rounds > 0)
+		{
+			play_batch();
+		}
+		else
+		{
+			play_headless();
+		}
+		exit(0);
+	}
+	else if (config->batch_rounds > 0)
+	{
+		fprintf(stderr, "Batch rounds need a board size given with --headless\n");
+		exit(1);
+	}
+
+	// Load the replay
+	static Replay loaded_replay;
+	if (config->replay_path != NULL)
+	{
+		if (!open_replay(&loaded_replay, config->replay_path))
+		{
+			fprintf(stderr, "Unable to read recording at %s\n", config->replay_path);
+			exit(1);
+		}
+		replay = &loaded_replay;
+
+		if (config->max_speed_flag)
+		{
+			play_replay_unthrottled();
+			free_replay(replay);
+			exit(0);
+		}
+	}
+
+	// Spectators connect before the terminal is set up, so errors can be printed
+	static Spectator spectator;
+	if (config->watch_path != NULL && config->renderer_kind == RENDERER_NULL)
+	{
+		fprintf(stderr, "Watching a broadcast needs a terminal\n");
+		exit(1);
+	}
+	else if (config->watch_path != NULL && !connect_spectator(&spectator, config->watch_path))
+	{
+		fprintf(stderr, "Unable to connect to the broadcast at %s\n", config->watch_path);
+		exit(1);
+	}
+
+	// Rounds are broadcast from the first one on, spectators may connect at any time
+	if (config->broadcast_path != NULL && config->watch_path == NULL)
+	{
+		if (!open_broadcast(&broadcast, config->broadcast_path))
+		{
+			fprintf(stderr, "Unable to broadcast at %s\n", config->broadcast_path);
+			exit(1);
+		}
+		atexit(finish_broadcast);
+	}
+
+	// Without a terminal nobody could play, so the computer plays or a replay
+	// runs through the game loop, which is timed as in the terminal
+	if (config->renderer_kind == RENDERER_NULL)
+	{
+		if (replay == NULL && !config->autopilot_flag && !config->bot_flag)
+		{
+			fprintf(stderr, "The null renderer needs --autopilot, --bot or --replay\n");
+			exit(1);
+		}
+		renderer = null_renderer(coord(NULL_SCREEN_WIDTH, NULL_SCREEN_HEIGHT));
+		if (config->perf_hud_flag)
+		{
+			toggle_perf_hud();
+		}
+		play_round();
+		if (replay != NULL)
+		{
+			free_replay(replay);
+		}
+		exit(0);
+	}
+	renderer = (config->renderer_kind == RENDERER_ANSI) ? ansi_renderer() : curses_renderer();
 
 	if (config->save_file_path != NULL)
 	{
 		// If the remove flag has been set we remove the file and exit
 		if (config->remove_flag)
 		{
-			remove(config->save_file_path);
+			remove_scores(config->save_file_path);
 			exit(0);
 		}
 		else
@@ -1645,9 +2116,36 @@ int main(int argc, char **argv)
 				fprintf(stderr, "If the error persists try using the --ignore-savefile flag!\n");
 				exit(1);
 			}
+
+			// New highscores are written in the background until the program ends
+			if (!config->ignore_flag)
+			{
+				if (!start_score_writer(&score_writer, config->save_file_path))
+				{
+					fprintf(stderr, "Unable to start writing the savefile at %s\n", config->save_file_path);
+					exit(1);
+				}
+				atexit(finish_score_file);
+
+				// Every round played is appended to the history
+				char *path = history_file_path();
+				if (path == NULL || !open_history(&history, path))
+				{
+					fprintf(stderr, "Unable to open the round history at %s\n", path != NULL ? path : "(unknown)");
+					fprintf(stderr, "If the error persists try using the --ignore-savefile flag!\n");
+					exit(1);
+				}
+				free(path);
+			}
 		}
 	}
 
+	// Show the performance HUD from the start
+	if (config->perf_hud_flag)
+	{
+		toggle_perf_hud();
+	}
+
 	// Init colors and ncurses specific functions
 	initscr();
 	start_color();
@@ -1665,12 +2163,28 @@ int main(int argc, char **argv)
 	init_pair(7, COLOR_BLACK, COLOR_RED);
 	init_pair(8, COLOR_BLACK, COLOR_YELLOW);
 	init_pair(9, COLOR_BLACK, COLOR_BLUE);
+	renderer->background = background;
 	bkgd(COLOR_PAIR(1));
 	curs_set(false);
 	noecho();
 	cbreak();
 	keypad(stdscr, true);
 
+	// Watching shows the rounds of another game instead of playing
+	if (config->watch_path != NULL)
+	{
+		watch_broadcast(&spectator);
+		clean_exit(0);
+	}
+
+	// A replay is played once without showing the title screen
+	if (replay != NULL)
+	{
+		play_round();
+		free_replay(replay);
+		clean_exit(0);
+	}
+
 	// Get screen dimensions
 	int max_x = getmaxx(stdscr);
 	int max_y = getmaxy(stdscr);